@@ -0,0 +1,113 @@
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// BC1 and BC3 (S3TC / DXT1 and DXT5) block decoding, the fallback for
+// drivers without GL_EXT_texture_compression_s3tc. The blocks are written
+// by Triangle/tools/texcook, which also has the encoder.
+enum BlockFormat {
+  BLOCK_BC1, // opaque RGB, 8 bytes per 4x4 block
+  BLOCK_BC3, // RGBA, 16 bytes per 4x4 block
+};
+
+inline size_t BlockBytes(BlockFormat format) {
+  return format == BLOCK_BC3 ? 16 : 8;
+}
+
+// bytes of a width x height image, partial edge blocks counting as whole
+inline size_t BlockCompressedSize(int width, int height,
+                                  BlockFormat format) {
+  size_t across = width > 0 ? (width + 3) / 4 : 1;
+  size_t down = height > 0 ? (height + 3) / 4 : 1;
+  return across * down * BlockBytes(format);
+}
+
+// decodes one block's colors; BC1 blocks with c0 <= c1 use three colors
+// plus transparent black, BC3 color blocks always use four
+// ------------------------------------------------------------------------
+inline void DecodeColorBlock(const unsigned char in[8],
+                             bool allowThreeColor, unsigned char block[64]) {
+  int palette[4][3];
+  uint16_t c0 = (uint16_t)(in[0] | in[1] << 8);
+  uint16_t c1 = (uint16_t)(in[2] | in[3] << 8);
+  const uint16_t endpoints[2] = {c0, c1};
+  for (int e = 0; e < 2; ++e) {
+    // replicate the high bits to 8 bits per channel, as the GPU does
+    int r = endpoints[e] >> 11 & 31, g = endpoints[e] >> 5 & 63;
+    int b = endpoints[e] & 31;
+    palette[e][0] = r << 3 | r >> 2;
+    palette[e][1] = g << 2 | g >> 4;
+    palette[e][2] = b << 3 | b >> 2;
+  }
+  bool threeColor = allowThreeColor && c0 <= c1;
+  for (int c = 0; c < 3; ++c) {
+    if (threeColor) {
+      palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+      palette[3][c] = 0;
+    } else {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+  }
+  uint32_t bits = (uint32_t)(in[4] | in[5] << 8 | in[6] << 16) |
+                  (uint32_t)in[7] << 24;
+  for (int i = 0; i < 16; ++i) {
+    int index = bits >> (2 * i) & 3;
+    for (int c = 0; c < 3; ++c)
+      block[i * 4 + c] = (unsigned char)palette[index][c];
+    block[i * 4 + 3] = threeColor && index == 3 ? 0 : 255;
+  }
+}
+
+// decodes the alpha half of a BC3 block
+// ------------------------------------------------------------------------
+inline void DecodeAlphaBlock(const unsigned char in[8],
+                             unsigned char block[64]) {
+  int a0 = in[0], a1 = in[1], palette[8] = {a0, a1};
+  if (a0 > a1) {
+    for (int i = 1; i < 7; ++i)
+      palette[1 + i] = ((7 - i) * a0 + i * a1) / 7;
+  } else {
+    for (int i = 1; i < 5; ++i)
+      palette[1 + i] = ((5 - i) * a0 + i * a1) / 5;
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+  uint64_t bits = 0;
+  for (int b = 0; b < 6; ++b)
+    bits |= (uint64_t)in[2 + b] << (8 * b);
+  for (int i = 0; i < 16; ++i)
+    block[i * 4 + 3] = (unsigned char)palette[bits >> (3 * i) & 7];
+}
+
+// decodes a whole image to tightly packed RGBA8
+// ------------------------------------------------------------------------
+inline void DecodeBlockImage(const unsigned char *blocks, int width,
+                             int height, BlockFormat format,
+                             unsigned char *rgba) {
+  int across = width > 0 ? (width + 3) / 4 : 1;
+  int down = height > 0 ? (height + 3) / 4 : 1;
+  size_t blockBytes = BlockBytes(format);
+  for (int by = 0; by < down; ++by) {
+    for (int bx = 0; bx < across; ++bx) {
+      const unsigned char *src =
+          blocks + ((size_t)by * across + bx) * blockBytes;
+      unsigned char block[64];
+      if (format == BLOCK_BC3) {
+        DecodeColorBlock(src + 8, false, block);
+        DecodeAlphaBlock(src, block);
+      } else {
+        DecodeColorBlock(src, true, block);
+      }
+      for (int y = 0; y < 4 && by * 4 + y < height; ++y)
+        for (int x = 0; x < 4 && bx * 4 + x < width; ++x)
+          std::memcpy(&rgba[((size_t)(by * 4 + y) * width + bx * 4 + x) * 4],
+                      &block[(y * 4 + x) * 4], 4);
+    }
+  }
+}
+
+#endif
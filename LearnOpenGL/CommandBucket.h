@@ -0,0 +1,92 @@
+#ifndef COMMAND_BUCKET_H
+#define COMMAND_BUCKET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Key layout, most significant first: program (10 bits), material or
+// texture set (14), VAO (16), view depth (24). Sorting by key groups draws
+// by state and orders each group front to back for early-Z. Names wider
+// than their field only weaken the grouping, never the draw itself.
+// ------------------------------------------------------------------------
+inline uint64_t MakeSortKey(unsigned int program, unsigned int material,
+                            unsigned int vao, float viewDepth) {
+  // the bit pattern of a non-negative float increases with its value, so
+  // its top 24 bits are an order-preserving depth quantization
+  if (!(viewDepth > 0.0f))
+    viewDepth = 0.0f;
+  uint32_t depthBits;
+  std::memcpy(&depthBits, &viewDepth, sizeof(depthBits));
+
+  return (uint64_t)(program & 0x3FFu) << 54 |
+         (uint64_t)(material & 0x3FFFu) << 40 |
+         (uint64_t)(vao & 0xFFFFu) << 24 | (uint64_t)(depthBits >> 8);
+}
+
+struct SortEntry {
+  uint64_t key;
+  uint32_t index;
+};
+
+// Stable LSD radix sort of entries by key, 8 bits per pass. Passes over
+// bytes that are equal in every key are skipped.
+// ------------------------------------------------------------------------
+inline void RadixSortKeys(std::vector<SortEntry> &entries,
+                          std::vector<SortEntry> &scratch) {
+  size_t count = entries.size();
+  if (count < 2)
+    return;
+  scratch.resize(count);
+
+  // bits that differ between at least two keys
+  uint64_t varying = 0;
+  for (const SortEntry &entry : entries)
+    varying |= entry.key ^ entries[0].key;
+
+  for (int shift = 0; shift < 64; shift += 8) {
+    if (((varying >> shift) & 0xFF) == 0)
+      continue;
+
+    size_t offsets[256] = {};
+    for (const SortEntry &entry : entries)
+      ++offsets[(entry.key >> shift) & 0xFF];
+    size_t sum = 0;
+    for (size_t &offset : offsets) {
+      size_t n = offset;
+      offset = sum;
+      sum += n;
+    }
+    for (const SortEntry &entry : entries)
+      scratch[offsets[(entry.key >> shift) & 0xFF]++] = entry;
+    entries.swap(scratch);
+  }
+}
+
+// Draw commands recorded in any order and submitted sorted by key.
+template <typename Command> class CommandBucket {
+public:
+  void Clear() {
+    commands.clear();
+    entries.clear();
+  }
+  void Add(uint64_t key, const Command &command) {
+    entries.push_back({key, (uint32_t)commands.size()});
+    commands.push_back(command);
+  }
+  size_t Size() const { return commands.size(); }
+
+  void Sort() { RadixSortKeys(entries, scratch); }
+  // Calls submit(command) for every command in key order.
+  template <typename Fn> void Submit(Fn submit) const {
+    for (const SortEntry &entry : entries)
+      submit(commands[entry.index]);
+  }
+
+private:
+  std::vector<Command> commands;
+  std::vector<SortEntry> entries, scratch;
+};
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef COOKED_TEXTURE_H
+#define COOKED_TEXTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Cooked texture files (.ctex) written by Triangle/tools/texcook: the full
+// mip chain in a fixed GPU pixel format, so loading is a memory map plus
+// one upload per level with no decode and no glGenerateMipmap.
+// Layout, little-endian and read in place: CookedTextureHeader, then
+// CookedLevelEntry[levelCount] (level 0 first), then the level data, each
+// level starting on a COOKED_DATA_ALIGNMENT boundary.
+const char COOKED_TEXTURE_MAGIC[4] = {'C', 'T', 'E', 'X'};
+const uint32_t COOKED_TEXTURE_VERSION = 1;
+const size_t COOKED_DATA_ALIGNMENT = 16;
+
+enum CookedFormat : uint32_t {
+  COOKED_RGBA8 = 1, // 8-bit RGBA, rows tightly packed
+  COOKED_BC1 = 2,   // BC1 / BC3 blocks (BlockCompression.h), row-major
+  COOKED_BC3 = 3,
+};
+
+struct CookedTextureHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t format;
+  uint32_t width, height;
+  uint32_t levelCount;
+  uint32_t reserved[2];
+};
+
+struct CookedLevelEntry {
+  uint64_t offset, size;
+  uint32_t width, height;
+};
+
+static_assert(sizeof(CookedTextureHeader) == 32, "header layout");
+static_assert(sizeof(CookedLevelEntry) == 24, "level entry layout");
+
+// read-only memory map of a cooked texture file
+class CookedTexture {
+public:
+  struct Level {
+    int width, height;
+    const unsigned char *data;
+    size_t size;
+  };
+
+  CookedTexture() = default;
+  ~CookedTexture() { Close(); }
+  CookedTexture(const CookedTexture &) = delete;
+  CookedTexture &operator=(const CookedTexture &) = delete;
+
+  // maps the file and validates header and level table; false if the file
+  // is missing, and the reason is printed if it exists but is unusable
+  // ------------------------------------------------------------------------
+  bool Open(const std::string &path) {
+    Close();
+#ifdef _WIN32
+    // no mmap; read the file into memory instead
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+      return false;
+    size = (size_t)file.tellg();
+    unsigned char *buffer = new unsigned char[size];
+    file.seekg(0);
+    file.read((char *)buffer, size);
+    data = buffer;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+      close(fd);
+      return false;
+    }
+    size = (size_t)info.st_size;
+    void *mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps the file open
+    close(fd);
+    if (mapped == MAP_FAILED) {
+      size = 0;
+      return false;
+    }
+    data = (const unsigned char *)mapped;
+#endif
+
+    header = (const CookedTextureHeader *)data;
+    levels = (const CookedLevelEntry *)(data + sizeof(CookedTextureHeader));
+    const char *problem = NULL;
+    if (size < sizeof(CookedTextureHeader) ||
+        std::memcmp(header->magic, COOKED_TEXTURE_MAGIC, 4) != 0)
+      problem = "not a cooked texture";
+    else if (header->version != COOKED_TEXTURE_VERSION)
+      problem = "unsupported version";
+    else if (header->levelCount == 0 || header->levelCount > 32 ||
+             size < sizeof(CookedTextureHeader) +
+                        header->levelCount * sizeof(CookedLevelEntry))
+      problem = "bad level table";
+    for (uint32_t i = 0; !problem && i < header->levelCount; ++i)
+      if (levels[i].offset > size || levels[i].size > size - levels[i].offset)
+        problem = "level data out of bounds";
+    if (problem) {
+      std::cout << "Cooked texture " << path << " unusable: " << problem
+                << std::endl;
+      Close();
+      return false;
+    }
+    return true;
+  }
+
+  void Close() {
+    if (data) {
+#ifdef _WIN32
+      delete[] data;
+#else
+      munmap((void *)data, size);
+#endif
+    }
+    data = NULL;
+    size = 0;
+    header = NULL;
+    levels = NULL;
+  }
+
+  uint32_t Format() const { return header->format; }
+  int LevelCount() const { return (int)header->levelCount; }
+  Level GetLevel(int level) const {
+    const CookedLevelEntry &entry = levels[level];
+    return {(int)entry.width, (int)entry.height, data + entry.offset,
+            (size_t)entry.size};
+  }
+
+private:
+  const unsigned char *data = NULL;
+  size_t size = 0;
+  const CookedTextureHeader *header = NULL;
+  const CookedLevelEntry *levels = NULL;
+};
+
+// path texcook writes for an image: the extension replaced by ".ctex"
+inline std::string CookedTexturePath(const std::string &imagePath) {
+  size_t dot = imagePath.find_last_of('.');
+  size_t slash = imagePath.find_last_of("/\\");
+  if (dot == std::string::npos ||
+      (slash != std::string::npos && dot < slash))
+    return imagePath + ".ctex";
+  return imagePath.substr(0, dot) + ".ctex";
+}
+
+#endif
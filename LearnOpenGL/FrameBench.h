@@ -0,0 +1,149 @@
+#ifndef FRAME_BENCH_H
+#define FRAME_BENCH_H
+
+#include "glad/glad.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Benchmark driver for the render loop: a fixed simulated time step
+// instead of wall-clock time, a warmup, then per-frame CPU, GPU (timer
+// query) and total frame times. Query results are read QUERY_LATENCY
+// frames late so they never stall the pipeline.
+class FrameBench {
+public:
+  FrameBench(int warmupFrames, int measuredFrames,
+             double timeStep = 1.0 / 60.0)
+      : warmupFrames(warmupFrames), measuredFrames(measuredFrames),
+        timeStep(timeStep) {
+    glGenQueries(QUERY_LATENCY, queries);
+    cpuMs.reserve(measuredFrames);
+    gpuMs.assign(measuredFrames, 0.0);
+    frameMs.reserve(measuredFrames);
+  }
+  ~FrameBench() { glDeleteQueries(QUERY_LATENCY, queries); }
+  FrameBench(const FrameBench &) = delete;
+  FrameBench &operator=(const FrameBench &) = delete;
+
+  // simulated seconds at the current frame
+  double Time() const { return frame * timeStep; }
+  bool Done() const { return frame >= warmupFrames + measuredFrames; }
+
+  // bracket the frame's rendering; EndFrame goes before the buffer swap
+  // ------------------------------------------------------------------------
+  void BeginFrame() {
+    std::chrono::steady_clock::time_point now =
+        std::chrono::steady_clock::now();
+    if (frame > 0 && frame > warmupFrames)
+      frameMs.push_back(Milliseconds(now - lastFrameStart));
+    lastFrameStart = now;
+    // the query slot is reused every QUERY_LATENCY frames; read it first
+    if (frame >= QUERY_LATENCY)
+      CollectGpuTime(frame - QUERY_LATENCY);
+    glBeginQuery(GL_TIME_ELAPSED, queries[frame % QUERY_LATENCY]);
+    cpuStart = now;
+  }
+  void EndFrame() {
+    glEndQuery(GL_TIME_ELAPSED);
+    std::chrono::steady_clock::time_point now =
+        std::chrono::steady_clock::now();
+    if (frame >= warmupFrames)
+      cpuMs.push_back(Milliseconds(now - cpuStart));
+    ++frame;
+    if (Done()) {
+      // the last frame's interval ends here, and its queries are drained
+      frameMs.push_back(Milliseconds(now - lastFrameStart));
+      for (int i = std::max(frame - QUERY_LATENCY, 0); i < frame; ++i)
+        CollectGpuTime(i);
+    }
+  }
+  // writes per-frame samples as CSV if path ends in ".csv", otherwise a
+  // JSON summary with mean and p50/p95/p99 of each series
+  // ------------------------------------------------------------------------
+  bool WriteReport(const std::string &path, const std::string &app) {
+    FILE *f = std::fopen(path.c_str(), "w");
+    if (!f) {
+      std::cout << "Failed to write benchmark report " << path << std::endl;
+      return false;
+    }
+    bool csv =
+        path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+    if (csv) {
+      std::fprintf(f, "frame,cpu_ms,gpu_ms,frame_ms\n");
+      for (size_t i = 0; i < cpuMs.size(); ++i)
+        std::fprintf(f, "%zu,%.4f,%.4f,%.4f\n", i, cpuMs[i], gpuMs[i],
+                     i < frameMs.size() ? frameMs[i] : 0.0);
+    } else {
+      Summary frames = Summarize(frameMs);
+      std::fprintf(f, "{\n");
+      std::fprintf(f, "  \"app\": \"%s\",\n", app.c_str());
+      std::fprintf(f, "  \"warmup_frames\": %d,\n", warmupFrames);
+      std::fprintf(f, "  \"frames\": %zu,\n", cpuMs.size());
+      std::fprintf(f, "  \"time_step\": %.6f,\n", timeStep);
+      std::fprintf(f, "  \"fps\": %.2f,\n",
+                   frames.mean > 0.0 ? 1000.0 / frames.mean : 0.0);
+      WriteSummary(f, "cpu_ms", Summarize(cpuMs), false);
+      WriteSummary(f, "gpu_ms", Summarize(gpuMs), false);
+      WriteSummary(f, "frame_ms", frames, true);
+      std::fprintf(f, "}\n");
+    }
+    std::fclose(f);
+    return true;
+  }
+
+private:
+  static const int QUERY_LATENCY = 3;
+
+  struct Summary {
+    double mean, p50, p95, p99;
+  };
+
+  int warmupFrames, measuredFrames;
+  double timeStep;
+  int frame = 0;
+  unsigned int queries[QUERY_LATENCY];
+  std::chrono::steady_clock::time_point cpuStart, lastFrameStart;
+  // indexed by measured frame; gpuMs is filled in late
+  std::vector<double> cpuMs, gpuMs, frameMs;
+
+  static double Milliseconds(std::chrono::steady_clock::duration d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+  }
+  // reads the query issued for frameIndex, blocking if it is not ready
+  void CollectGpuTime(int frameIndex) {
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(queries[frameIndex % QUERY_LATENCY],
+                          GL_QUERY_RESULT, &elapsed);
+    if (frameIndex >= warmupFrames)
+      gpuMs[frameIndex - warmupFrames] = elapsed / 1.0e6;
+  }
+  // nearest-rank percentiles of the samples
+  static Summary Summarize(std::vector<double> samples) {
+    Summary s = {0.0, 0.0, 0.0, 0.0};
+    if (samples.empty())
+      return s;
+    std::sort(samples.begin(), samples.end());
+    for (double v : samples)
+      s.mean += v;
+    s.mean /= samples.size();
+    s.p50 = Rank(samples, 0.50);
+    s.p95 = Rank(samples, 0.95);
+    s.p99 = Rank(samples, 0.99);
+    return s;
+  }
+  static double Rank(const std::vector<double> &sorted, double p) {
+    size_t i = (size_t)(p * sorted.size() + 0.5);
+    return sorted[std::min(std::max(i, (size_t)1), sorted.size()) - 1];
+  }
+  static void WriteSummary(FILE *f, const char *name, const Summary &s,
+                           bool last) {
+    std::fprintf(f,
+                 "  \"%s\": {\"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, "
+                 "\"p99\": %.4f}%s\n",
+                 name, s.mean, s.p50, s.p95, s.p99, last ? "" : ",");
+  }
+};
+#endif
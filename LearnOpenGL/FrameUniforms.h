@@ -0,0 +1,51 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include "glad/glad.h"
+#include <glm/glm.hpp>
+
+// CPU mirror of the std140 FrameUniforms block declared in the shaders.
+// vec3 values are stored as vec4 because std140 pads them to 16 bytes.
+struct FrameData {
+  glm::mat4 view;
+  glm::mat4 projection;
+  glm::vec4 viewPos;
+  glm::vec4 lightPos;
+  glm::vec4 lightColor;
+};
+
+// CPU mirror of the std140 ObjectUniforms block. The normal matrix is kept
+// as a mat4 because std140 pads mat3 columns to vec4 anyway.
+struct ObjectData {
+  glm::mat4 model;
+  glm::mat4 normalMatrix;
+};
+
+// Per-object transforms are streamed into ranges bound here.
+const unsigned int OBJECT_UNIFORMS_BINDING = 1;
+
+// Uniform buffer holding per-frame camera and light data, shared by every
+// program whose FrameUniforms block is bound to BINDING
+class FrameUniforms {
+public:
+  static const unsigned int BINDING = 0;
+  unsigned int UBO;
+
+  // creates the buffer and attaches it to the binding point
+  // ------------------------------------------------------------------------
+  FrameUniforms() {
+    glGenBuffers(1, &UBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, UBO);
+  }
+  // uploads the whole block with a single buffer write
+  // ------------------------------------------------------------------------
+  void Update(const FrameData &data) {
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  }
+};
+#endif
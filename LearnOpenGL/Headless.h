@@ -0,0 +1,190 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include "glad/glad.h"
+#include <chrono>
+#include <iostream>
+
+#ifdef HEADLESS_OSMESA
+#include <GL/osmesa.h>
+#else
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+// GL context without a window or display, for build machines with neither.
+// EGL on Mesa's surfaceless platform by default, OSMesa when built with
+// HEADLESS_OSMESA; frames are rendered into a framebuffer object.
+class HeadlessContext {
+public:
+  HeadlessContext() = default;
+  ~HeadlessContext() { Destroy(); }
+  HeadlessContext(const HeadlessContext &) = delete;
+  HeadlessContext &operator=(const HeadlessContext &) = delete;
+
+  // creates a GL 3.3 core context and makes it current; false if no
+  // headless context is available
+  // ------------------------------------------------------------------------
+  bool Create(int w, int h) {
+#ifdef HEADLESS_OSMESA
+    const int attribs[] = {OSMESA_FORMAT,
+                           OSMESA_RGBA,
+                           OSMESA_DEPTH_BITS,
+                           24,
+                           OSMESA_PROFILE,
+                           OSMESA_CORE_PROFILE,
+                           OSMESA_CONTEXT_MAJOR_VERSION,
+                           3,
+                           OSMESA_CONTEXT_MINOR_VERSION,
+                           3,
+                           0};
+    OSMesaContext ctx = OSMesaCreateContextAttribs(attribs, NULL);
+    // OSMesa needs a client-side buffer to make the context current even
+    // though everything is drawn into the FBO
+    osmesaBuffer = new unsigned char[(size_t)w * h * 4];
+    if (!ctx || !OSMesaMakeCurrent(ctx, osmesaBuffer, GL_UNSIGNED_BYTE, w, h)) {
+      std::cout << "Failed to create OSMesa context" << std::endl;
+      if (ctx)
+        OSMesaDestroyContext(ctx);
+      delete[] osmesaBuffer;
+      osmesaBuffer = NULL;
+      return false;
+    }
+#else
+    // the surfaceless platform needs neither a display server nor a GPU;
+    // with no GPU Mesa falls back to llvmpipe
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+            "eglGetPlatformDisplayEXT");
+    EGLDisplay dpy = getPlatformDisplay
+                         ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                              EGL_DEFAULT_DISPLAY, NULL)
+                         : EGL_NO_DISPLAY;
+    if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, NULL, NULL)) {
+      std::cout << "Failed to open a surfaceless EGL display" << std::endl;
+      return false;
+    }
+    // the default EGL_SURFACE_TYPE asks for window support, which the
+    // surfaceless platform has none of
+    const EGLint configAttribs[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                                    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                                    EGL_NONE};
+    const EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                     3,
+                                     EGL_CONTEXT_MINOR_VERSION,
+                                     3,
+                                     EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                     EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                     EGL_NONE};
+    EGLConfig config;
+    EGLint configCount = 0;
+    eglChooseConfig(dpy, configAttribs, &config, 1, &configCount);
+    EGLContext ctx = EGL_NO_CONTEXT;
+    if (configCount > 0 && eglBindAPI(EGL_OPENGL_API))
+      ctx = eglCreateContext(dpy, config, EGL_NO_CONTEXT, contextAttribs);
+    if (ctx == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx)) {
+      std::cout << "Failed to create EGL context" << std::endl;
+      if (ctx != EGL_NO_CONTEXT)
+        eglDestroyContext(dpy, ctx);
+      eglTerminate(dpy);
+      return false;
+    }
+    display = dpy;
+#endif
+    context = ctx;
+    width = w;
+    height = h;
+    start = std::chrono::steady_clock::now();
+    return true;
+  }
+  // GL entry point lookup for gladLoadGLLoader
+  // ------------------------------------------------------------------------
+  static void *GetProcAddress(const char *name) {
+#ifdef HEADLESS_OSMESA
+    return (void *)OSMesaGetProcAddress(name);
+#else
+    return (void *)eglGetProcAddress(name);
+#endif
+  }
+  // creates the FBO and leaves it bound; call once GL is loaded
+  // ------------------------------------------------------------------------
+  void CreateFramebuffer() {
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width,
+                          height);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                              GL_RENDERBUFFER, colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                              GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+      std::cout << "Headless framebuffer is not complete" << std::endl;
+    glViewport(0, 0, width, height);
+  }
+  // stands in for a buffer swap: flushes the frame and keeps at most
+  // MAX_FRAMES_IN_FLIGHT frames queued
+  // ------------------------------------------------------------------------
+  void EndFrame() {
+    GLsync &fence = frameFences[frameIndex];
+    if (fence) {
+      glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+      glDeleteSync(fence);
+    }
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    frameIndex = (frameIndex + 1) % MAX_FRAMES_IN_FLIGHT;
+  }
+  // seconds since Create, standing in for glfwGetTime
+  double GetTime() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+  }
+  void Destroy() {
+    if (!context)
+      return;
+    for (GLsync &fence : frameFences) {
+      if (fence)
+        glDeleteSync(fence);
+      fence = NULL;
+    }
+    if (framebuffer) {
+      glDeleteFramebuffers(1, &framebuffer);
+      glDeleteRenderbuffers(1, &colorBuffer);
+      glDeleteRenderbuffers(1, &depthBuffer);
+      framebuffer = colorBuffer = depthBuffer = 0;
+    }
+#ifdef HEADLESS_OSMESA
+    OSMesaDestroyContext((OSMesaContext)context);
+    delete[] osmesaBuffer;
+    osmesaBuffer = NULL;
+#else
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display, context);
+    eglTerminate(display);
+    display = NULL;
+#endif
+    context = NULL;
+  }
+
+  int Width() const { return width; }
+  int Height() const { return height; }
+
+private:
+  static const int MAX_FRAMES_IN_FLIGHT = 2;
+
+  int width = 0, height = 0;
+  void *display = NULL, *context = NULL;
+  unsigned char *osmesaBuffer = NULL;
+  unsigned int framebuffer = 0, colorBuffer = 0, depthBuffer = 0;
+  GLsync frameFences[MAX_FRAMES_IN_FLIGHT] = {};
+  int frameIndex = 0;
+  std::chrono::steady_clock::time_point start;
+};
+#endif
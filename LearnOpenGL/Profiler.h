@@ -0,0 +1,280 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "glad/glad.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// totals of one named scope over a frame
+struct ProfileScopeStats {
+  const char *name;
+  double cpuMs = 0.0;
+  double gpuMs = 0.0;
+  unsigned int calls = 0;
+};
+
+// Scoped CPU and GPU profiler for the render thread, inert until Enable().
+// CPU scopes read the steady clock; GPU scopes bracket themselves with
+// GL_TIMESTAMP queries, which unlike GL_TIME_ELAPSED may nest and overlap
+// FrameBench's frame query. Queries are double-buffered by frame:
+// BeginFrame collects the set written two frames ago, so LastFrame()
+// describes that frame. Scope names must be string literals.
+class Profiler {
+public:
+  static Profiler &Instance() {
+    static Profiler profiler;
+    return profiler;
+  }
+
+  // starts profiling (needs a current GL context); with captureTrace every
+  // scope is also kept for WriteTrace
+  // ------------------------------------------------------------------------
+  void Enable(bool captureTrace) {
+    this->captureTrace = captureTrace;
+    if (enabled)
+      return;
+    enabled = true;
+    GLint64 now = 0;
+    glGetInteger64v(GL_TIMESTAMP, &now);
+    gpuEpoch = now;
+    cpuEpoch = Clock::now();
+    Current().frame = frame;
+  }
+  bool Enabled() const { return enabled; }
+
+  // closes the current frame and publishes the totals of the frame that
+  // last used its query set; call it outside of any scope
+  // ------------------------------------------------------------------------
+  void BeginFrame() {
+    if (!enabled)
+      return;
+    ++frame;
+    FrameSet &set = Current();
+    if (set.frame >= 0) {
+      Collect(set);
+      lastFrame.swap(set.totals);
+    }
+    set.frame = frame;
+    set.totals.clear();
+    set.usedQueries = 0;
+  }
+  const std::vector<ProfileScopeStats> &LastFrame() const {
+    return lastFrame;
+  }
+
+  // writes the captured scopes in the Chrome trace event format
+  // (chrome://tracing, Perfetto)
+  // ------------------------------------------------------------------------
+  bool WriteTrace(const std::string &path) {
+    // the last two frames' GPU scopes are still pending
+    for (long f = frame - FRAME_SETS + 1; f <= frame; ++f)
+      if (f >= 0 && sets[f % FRAME_SETS].frame == f)
+        Collect(sets[f % FRAME_SETS]);
+
+    FILE *f = std::fopen(path.c_str(), "w");
+    if (!f) {
+      std::cout << "ERROR::PROFILER::CANNOT_WRITE " << path << std::endl;
+      return false;
+    }
+    // CPU scopes on thread 1, GPU scopes on thread 2
+    std::fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    std::fprintf(f, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+                    "\"tid\": 1, \"args\": {\"name\": \"CPU\"}},\n");
+    std::fprintf(f, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+                    "\"tid\": 2, \"args\": {\"name\": \"GPU\"}}");
+    for (const TraceEvent &event : trace) {
+      std::fprintf(f, ",\n{\"name\": \"");
+      for (const char *c = event.name; *c; ++c) {
+        if (*c == '"' || *c == '\\')
+          std::fputc('\\', f);
+        std::fputc(*c, f);
+      }
+      std::fprintf(f,
+                   "\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, "
+                   "\"dur\": %.3f, \"pid\": 1, \"tid\": %d}",
+                   event.gpu ? "gpu" : "cpu", event.startUs,
+                   event.durationUs, event.gpu ? 2 : 1);
+    }
+    std::fprintf(f, "\n]}\n");
+    std::fclose(f);
+    return true;
+  }
+
+  // releases the queries; the GL context must still be current
+  void Destroy() {
+    for (FrameSet &set : sets) {
+      if (!set.queries.empty())
+        glDeleteQueries((GLsizei)set.queries.size(), set.queries.data());
+      set = FrameSet();
+    }
+    cpuStack.clear();
+    gpuStack.clear();
+    enabled = false;
+  }
+
+  // used by the scope guards below
+  // ------------------------------------------------------------------------
+  void BeginCpu(const char *name) { cpuStack.push_back({name, Clock::now()}); }
+  void EndCpu() {
+    const OpenScope &scope = cpuStack.back();
+    Clock::time_point end = Clock::now();
+    ProfileScopeStats &stats = Totals(Current(), scope.name);
+    stats.cpuMs += Microseconds(end - scope.start) / 1000.0;
+    ++stats.calls;
+    AddEvent(scope.name, false, Microseconds(scope.start - cpuEpoch),
+             Microseconds(end - scope.start));
+    cpuStack.pop_back();
+  }
+  void BeginGpu(const char *name) {
+    FrameSet &set = Current();
+    unsigned int first = ReserveQueries(set);
+    glQueryCounter(set.queries[first], GL_TIMESTAMP);
+    gpuStack.push_back((unsigned int)set.gpuScopes.size());
+    set.gpuScopes.push_back({name, first});
+  }
+  void EndGpu() {
+    FrameSet &set = Current();
+    glQueryCounter(set.queries[set.gpuScopes[gpuStack.back()].first + 1],
+                   GL_TIMESTAMP);
+    gpuStack.pop_back();
+  }
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  // cap on captured events, so a long session does not grow without bound
+  static const size_t MAX_TRACE_EVENTS = 1 << 20;
+  static const int FRAME_SETS = 2;
+
+  struct OpenScope {
+    const char *name;
+    Clock::time_point start;
+  };
+  struct GpuScope {
+    const char *name;
+    unsigned int first; // start query; the end query follows it
+  };
+  // one frame's CPU totals and GPU queries awaiting their results
+  struct FrameSet {
+    long frame = -1;
+    std::vector<ProfileScopeStats> totals;
+    std::vector<GpuScope> gpuScopes;
+    std::vector<unsigned int> queries;
+    unsigned int usedQueries = 0;
+  };
+  struct TraceEvent {
+    const char *name;
+    bool gpu;
+    double startUs, durationUs;
+  };
+
+  Profiler() = default;
+
+  bool enabled = false;
+  bool captureTrace = false;
+  long frame = 0;
+  FrameSet sets[FRAME_SETS];
+  std::vector<OpenScope> cpuStack;
+  std::vector<unsigned int> gpuStack;
+  std::vector<ProfileScopeStats> lastFrame;
+  std::vector<TraceEvent> trace;
+
+  // CPU and GPU clock readings taken together, to line up GPU events
+  Clock::time_point cpuEpoch;
+  long long gpuEpoch = 0;
+
+  static double Microseconds(Clock::duration d) {
+    return std::chrono::duration<double, std::micro>(d).count();
+  }
+  FrameSet &Current() { return sets[frame % FRAME_SETS]; }
+  ProfileScopeStats &Totals(FrameSet &set, const char *name) {
+    for (ProfileScopeStats &stats : set.totals)
+      if (stats.name == name || std::strcmp(stats.name, name) == 0)
+        return stats;
+    set.totals.push_back(ProfileScopeStats());
+    set.totals.back().name = name;
+    return set.totals.back();
+  }
+  // index of two free queries in set, generated in blocks as needed
+  unsigned int ReserveQueries(FrameSet &set) {
+    if (set.usedQueries + 2 > set.queries.size()) {
+      size_t count = set.queries.empty() ? 32 : set.queries.size();
+      set.queries.resize(set.queries.size() + count);
+      glGenQueries((GLsizei)count, &set.queries[set.queries.size() - count]);
+    }
+    unsigned int first = set.usedQueries;
+    set.usedQueries += 2;
+    return first;
+  }
+  void Collect(FrameSet &set) {
+    for (const GpuScope &scope : set.gpuScopes) {
+      GLuint64 start = 0, end = 0;
+      glGetQueryObjectui64v(set.queries[scope.first], GL_QUERY_RESULT,
+                            &start);
+      glGetQueryObjectui64v(set.queries[scope.first + 1], GL_QUERY_RESULT,
+                            &end);
+      double durationUs = (end - start) / 1000.0;
+      Totals(set, scope.name).gpuMs += durationUs / 1000.0;
+      AddEvent(scope.name, true, ((long long)start - gpuEpoch) / 1000.0,
+               durationUs);
+    }
+    set.gpuScopes.clear();
+  }
+  void AddEvent(const char *name, bool gpu, double startUs,
+                double durationUs) {
+    if (captureTrace && trace.size() < MAX_TRACE_EVENTS)
+      trace.push_back({name, gpu, startUs, durationUs});
+  }
+};
+
+// times its enclosing scope on the CPU
+class CpuProfileScope {
+public:
+  explicit CpuProfileScope(const char *name)
+      : active(Profiler::Instance().Enabled()) {
+    if (active)
+      Profiler::Instance().BeginCpu(name);
+  }
+  ~CpuProfileScope() {
+    if (active)
+      Profiler::Instance().EndCpu();
+  }
+  CpuProfileScope(const CpuProfileScope &) = delete;
+  CpuProfileScope &operator=(const CpuProfileScope &) = delete;
+
+private:
+  bool active;
+};
+
+// times its enclosing scope on both the CPU and the GPU
+class GpuProfileScope {
+public:
+  explicit GpuProfileScope(const char *name)
+      : cpu(name), active(Profiler::Instance().Enabled()) {
+    if (active)
+      Profiler::Instance().BeginGpu(name);
+  }
+  ~GpuProfileScope() {
+    if (active)
+      Profiler::Instance().EndGpu();
+  }
+  GpuProfileScope(const GpuProfileScope &) = delete;
+  GpuProfileScope &operator=(const GpuProfileScope &) = delete;
+
+private:
+  CpuProfileScope cpu;
+  bool active;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_CPU(name)                                                  \
+  CpuProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_GPU(name)                                                  \
+  GpuProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include "glad/glad.h"
+#include <chrono>
+#include <cstddef>
+
+// Fence wait time accumulated since the last TakeWaitStats call.
+struct RingWaitStats {
+  unsigned int frames = 0;
+  // frames whose region was still in use by the GPU
+  unsigned int stalledFrames = 0;
+  double totalMs = 0.0, maxMs = 0.0;
+};
+
+// Streaming buffer split into FRAME_COUNT regions, one written per frame.
+// Before a region is reused, BeginFrame waits on the fence placed when it
+// was last submitted, so the driver never has to synchronize implicitly.
+// Persistently mapped on GL 4.4, mapped unsynchronized per frame otherwise.
+class RingBuffer {
+public:
+  static const int FRAME_COUNT = 3;
+
+  // creates the buffer; target is the binding used for mapping. There is
+  // no destructor cleanup: call Destroy() while the context is current
+  // ------------------------------------------------------------------------
+  RingBuffer(GLenum target, size_t frameSize)
+      : target(target), frameSize(frameSize), persistent(GLAD_GL_VERSION_4_4) {
+    glGenBuffers(1, &buffer);
+    glBindBuffer(target, buffer);
+    GLsizeiptr totalSize = (GLsizeiptr)(frameSize * FRAME_COUNT);
+    if (persistent) {
+      GLbitfield flags =
+          GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+      glBufferStorage(target, totalSize, NULL, flags);
+      mapped = (unsigned char *)glMapBufferRange(target, 0, totalSize, flags);
+    } else {
+      glBufferData(target, totalSize, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(target, 0);
+  }
+  RingBuffer(const RingBuffer &) = delete;
+  RingBuffer &operator=(const RingBuffer &) = delete;
+
+  // waits until the next region is free and makes it writable
+  // ------------------------------------------------------------------------
+  void BeginFrame() {
+    region = (region + 1) % FRAME_COUNT;
+    used = 0;
+    ++waitStats.frames;
+    if (fences[region]) {
+      // only time the wait when the GPU is actually behind
+      if (glClientWaitSync(fences[region], 0, 0) == GL_TIMEOUT_EXPIRED) {
+        auto start = std::chrono::steady_clock::now();
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        while (glClientWaitSync(fences[region], flags, 1000000) ==
+               GL_TIMEOUT_EXPIRED)
+          flags = 0;
+        double ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+        ++waitStats.stalledFrames;
+        waitStats.totalMs += ms;
+        if (ms > waitStats.maxMs)
+          waitStats.maxMs = ms;
+      }
+      glDeleteSync(fences[region]);
+      fences[region] = NULL;
+    }
+    if (!persistent) {
+      // the fence above already guarantees the GPU is done with the region
+      glBindBuffer(target, buffer);
+      mapped = (unsigned char *)glMapBufferRange(
+          target, (GLintptr)(region * frameSize), (GLsizeiptr)frameSize,
+          GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT |
+              GL_MAP_INVALIDATE_RANGE_BIT);
+    }
+  }
+  // reserves size bytes at an aligned offset from the start of the buffer;
+  // returns NULL when the frame's region is full
+  // ------------------------------------------------------------------------
+  void *Allocate(size_t size, size_t alignment, size_t &offset) {
+    size_t start = (used + alignment - 1) / alignment * alignment;
+    if (!mapped || start + size > frameSize)
+      return NULL;
+    used = start + size;
+    offset = region * frameSize + start;
+    return persistent ? mapped + offset : mapped + start;
+  }
+  // ends writing for this frame; call before drawing from the buffer
+  // ------------------------------------------------------------------------
+  void FinishWrites() {
+    if (!persistent && mapped) {
+      glBindBuffer(target, buffer);
+      glUnmapBuffer(target);
+      mapped = NULL;
+    }
+  }
+  // fences the region once the frame's draws have been issued
+  // ------------------------------------------------------------------------
+  void EndFrame() {
+    FinishWrites();
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+
+  // releases the fences and the buffer; call while the context is still
+  // current, since the owner usually outlives it
+  // ------------------------------------------------------------------------
+  void Destroy() {
+    for (GLsync &fence : fences) {
+      if (fence)
+        glDeleteSync(fence);
+      fence = NULL;
+    }
+    if (mapped) {
+      glBindBuffer(target, buffer);
+      glUnmapBuffer(target);
+      glBindBuffer(target, 0);
+    }
+    mapped = NULL;
+    if (buffer)
+      glDeleteBuffers(1, &buffer);
+    buffer = 0;
+  }
+
+  unsigned int Buffer() const { return buffer; }
+  // returns the wait statistics gathered so far and resets them
+  RingWaitStats TakeWaitStats() {
+    RingWaitStats stats = waitStats;
+    waitStats = RingWaitStats();
+    return stats;
+  }
+
+private:
+  GLenum target;
+  unsigned int buffer = 0;
+  size_t frameSize;
+  bool persistent;
+  // whole buffer when persistent, the current region otherwise
+  unsigned char *mapped = NULL;
+  GLsync fences[FRAME_COUNT] = {};
+  int region = 0;
+  size_t used = 0;
+  RingWaitStats waitStats;
+};
+#endif
@@ -1,4 +1,5 @@
 #pragma once
+#include "Profiler.h"
 #include "glad/glad.h"
 #include <fstream>
 #include <glm/ext/matrix_float4x4.hpp>
@@ -13,6 +14,7 @@ public:
   // constructor generates the shader on the fly
   // ------------------------------------------------------------------------
   Shader(const char *vertexPath, const char *fragmentPath) {
+    PROFILE_CPU("Shader compile");
     // 1. retrieve the vertex/fragment source code from filePath
     std::string vertexCode;
     std::string fragmentCode;
@@ -66,7 +68,16 @@ public:
   }
   // activate the shader
   // ------------------------------------------------------------------------
-  void use() { glUseProgram(ID); }
+  void use() const { glUseProgram(ID); }
+  // points the named uniform block at a buffer binding point; programs that
+  // do not declare the block are left untouched
+  // ------------------------------------------------------------------------
+  void bindUniformBlock(const std::string &blockName,
+                        unsigned int binding) const {
+    unsigned int index = glGetUniformBlockIndex(ID, blockName.c_str());
+    if (index != GL_INVALID_INDEX)
+      glUniformBlockBinding(ID, index, binding);
+  }
   // utility uniform functions
   // ------------------------------------------------------------------------
   void setBool(const std::string &name, bool value) const {
@@ -80,6 +91,10 @@ public:
   void setFloat(const std::string &name, float value) const {
     glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
   }
+  void setMat3(const std::string &name, const glm::mat3 &mat) const {
+    glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
+                       glm::value_ptr(mat));
+  }
   void setMat4(const std::string &name, const glm::mat4 &mat) const {
     glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
                        glm::value_ptr(mat));
@@ -1,9 +1,18 @@
 #version 330 core
 layout(location = 0) in vec3 aPos;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout(std140) uniform ObjectUniforms {
+    mat4 model;
+    mat4 normalMatrix;
+};
+
+layout(std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 lightPos;
+    vec4 lightColor;
+};
 
 void main() {
     gl_Position = projection * view * model * vec4(aPos, 1.0);
@@ -0,0 +1,233 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include "TextureLoader.h"
+#include "glad/glad.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// sampling state of a cached texture; without sampler objects it lives in
+// the texture itself, so one image with two samplers is two textures
+struct SamplerKey {
+  GLint wrapS = GL_REPEAT;
+  GLint wrapT = GL_REPEAT;
+  GLint minFilter = GL_LINEAR_MIPMAP_LINEAR;
+  GLint magFilter = GL_LINEAR;
+};
+
+class TextureCache;
+
+// Counted reference to a texture in a TextureCache; copies share the
+// texture. Once the last reference is gone the texture stays resident, so
+// acquiring it again is free, until the cache needs the memory.
+class TextureHandle {
+public:
+  TextureHandle() = default;
+  TextureHandle(const TextureHandle &other);
+  TextureHandle(TextureHandle &&other) noexcept
+      : cache(other.cache), slot(other.slot) {
+    other.cache = NULL;
+  }
+  TextureHandle &operator=(TextureHandle other) noexcept {
+    std::swap(cache, other.cache);
+    std::swap(slot, other.slot);
+    return *this;
+  }
+  ~TextureHandle() { Reset(); }
+
+  // 0 for an empty handle
+  unsigned int Id() const;
+  explicit operator bool() const { return cache != NULL; }
+  // drops the reference, leaving the handle empty
+  void Reset();
+
+private:
+  friend class TextureCache;
+  TextureHandle(TextureCache *cache, size_t slot);
+
+  TextureCache *cache = NULL;
+  size_t slot = 0;
+};
+
+// Shares one GL texture between every user of the same image file and
+// sampler; paths are made canonical first, so "Textures/a.png" and
+// "./Textures/a.png" are the same texture. New textures are loaded through
+// the TextureLoader. Textures nobody references are deleted least recently
+// used first while the resident total is over the budget; sizes are the
+// loader's estimates from the file headers, so nothing waits for the GPU.
+// Render thread only; handles must not outlive the cache.
+class TextureCache {
+public:
+  static const size_t DEFAULT_BUDGET = 256 << 20;
+
+  explicit TextureCache(TextureLoader &loader,
+                        size_t budgetBytes = DEFAULT_BUDGET)
+      : loader(loader), budget(budgetBytes) {}
+  TextureCache(const TextureCache &) = delete;
+  TextureCache &operator=(const TextureCache &) = delete;
+
+  // the cached texture for path and sampler, created and queued for
+  // loading on a miss
+  // ------------------------------------------------------------------------
+  TextureHandle Acquire(const std::string &path,
+                        const SamplerKey &sampler = SamplerKey()) {
+    std::string key = CacheKey(path, sampler);
+    auto found = lookup.find(key);
+    if (found != lookup.end())
+      return TextureHandle(this, found->second);
+
+    size_t slot;
+    if (!freeSlots.empty()) {
+      slot = freeSlots.back();
+      freeSlots.pop_back();
+    } else {
+      slot = entries.size();
+      entries.emplace_back();
+    }
+    Entry &entry = entries[slot];
+    entry.key = key;
+    glGenTextures(1, &entry.texture);
+    glBindTexture(GL_TEXTURE_2D, entry.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sampler.wrapS);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, sampler.wrapT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, sampler.minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampler.magFilter);
+    entry.bytes = loader.Load(entry.texture, path);
+    lookup[key] = slot;
+    residentBytes += entry.bytes;
+
+    TextureHandle handle(this, slot);
+    // make room for the new texture among the unreferenced ones
+    Trim();
+    return handle;
+  }
+
+  // evicts straight away if the resident total is over the new budget
+  void SetBudget(size_t bytes) {
+    budget = bytes;
+    Trim();
+  }
+  size_t Budget() const { return budget; }
+  size_t ResidentBytes() const { return residentBytes; }
+  size_t ResidentCount() const { return lookup.size(); }
+  // evictions since the cache was created
+  size_t Evictions() const { return evictions; }
+
+  // evicts unreferenced textures while over budget; textures still
+  // streaming in are skipped until a later call, since the loader needs
+  // them until their upload completes. Call it once per frame after the
+  // loader's Update
+  // ------------------------------------------------------------------------
+  void Trim() {
+    while (residentBytes > budget) {
+      // few distinct textures are resident, so a scan beats keeping a list
+      size_t oldest = entries.size();
+      for (size_t i = 0; i < entries.size(); ++i)
+        if (!entries[i].key.empty() && entries[i].references == 0 &&
+            !loader.IsPending(entries[i].texture) &&
+            (oldest == entries.size() ||
+             entries[i].lastUse < entries[oldest].lastUse))
+          oldest = i;
+      if (oldest == entries.size())
+        return; // everything left is in use or still loading
+      Evict(oldest);
+    }
+  }
+
+  // deletes every texture, referenced or not, while the context is still
+  // current; handles still held afterwards may only be reset or destroyed
+  void Destroy() {
+    for (Entry &entry : entries)
+      if (!entry.key.empty())
+        glDeleteTextures(1, &entry.texture);
+    entries.clear();
+    freeSlots.clear();
+    lookup.clear();
+    residentBytes = 0;
+  }
+
+private:
+  friend class TextureHandle;
+
+  struct Entry {
+    std::string key; // empty for a free slot
+    unsigned int texture = 0;
+    size_t bytes = 0;
+    unsigned int references = 0;
+    uint64_t lastUse = 0;
+  };
+
+  TextureLoader &loader;
+  size_t budget;
+  size_t residentBytes = 0;
+  size_t evictions = 0;
+  uint64_t useClock = 0;
+  std::vector<Entry> entries;
+  std::vector<size_t> freeSlots;
+  std::unordered_map<std::string, size_t> lookup;
+
+  // same file, same string: resolves "." and "..", symlinks and the
+  // working directory; missing files keep the path as given
+  static std::string CacheKey(const std::string &path,
+                              const SamplerKey &sampler) {
+    std::error_code error;
+    std::filesystem::path canonical =
+        std::filesystem::weakly_canonical(path, error);
+    return (error ? path : canonical.string()) + '|' +
+           std::to_string(sampler.wrapS) + ',' +
+           std::to_string(sampler.wrapT) + ',' +
+           std::to_string(sampler.minFilter) + ',' +
+           std::to_string(sampler.magFilter);
+  }
+
+  void AddReference(size_t slot) {
+    ++entries[slot].references;
+    entries[slot].lastUse = ++useClock;
+  }
+  void Release(size_t slot) {
+    // handles released after Destroy() find the slot gone
+    if (slot >= entries.size())
+      return;
+    Entry &entry = entries[slot];
+    entry.lastUse = ++useClock;
+    if (--entry.references == 0)
+      Trim();
+  }
+  void Evict(size_t slot) {
+    Entry &entry = entries[slot];
+    glDeleteTextures(1, &entry.texture);
+    lookup.erase(entry.key);
+    residentBytes -= entry.bytes;
+    ++evictions;
+    entry = Entry();
+    freeSlots.push_back(slot);
+  }
+};
+
+inline TextureHandle::TextureHandle(TextureCache *cache, size_t slot)
+    : cache(cache), slot(slot) {
+  cache->AddReference(slot);
+}
+
+inline TextureHandle::TextureHandle(const TextureHandle &other)
+    : cache(other.cache), slot(other.slot) {
+  if (cache)
+    cache->AddReference(slot);
+}
+
+inline unsigned int TextureHandle::Id() const {
+  return cache ? cache->entries[slot].texture : 0;
+}
+
+inline void TextureHandle::Reset() {
+  if (cache)
+    cache->Release(slot);
+  cache = NULL;
+}
+
+#endif
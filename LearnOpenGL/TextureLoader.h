@@ -0,0 +1,591 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include "BlockCompression.h"
+#include "CookedTexture.h"
+#include "Profiler.h"
+#include "glad/glad.h"
+// main.cpp includes stb_image.h with its implementation; including it
+// again while STB_IMAGE_IMPLEMENTATION is defined would repeat that
+#ifndef STBI_INCLUDE_STB_IMAGE_H
+#include "stb_image.h"
+#endif
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// from GL_EXT_texture_compression_s3tc, which glad.h does not include
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// queue depths and upload traffic of a TextureLoader
+struct TextureStreamStats {
+  size_t decodeQueue = 0; // waiting for or being decoded
+  size_t uploadQueue = 0; // decoded or cooked, not yet uploaded
+  // since the previous TakeStats call
+  unsigned int frames = 0;
+  unsigned int texturesCompleted = 0;
+  size_t bytesUploaded = 0;
+  double seconds = 0.0;
+
+  double MegabytesPerSecond() const {
+    return seconds > 0.0 ? bytesUploaded / (seconds * 1.0e6) : 0.0;
+  }
+};
+
+// Decodes image files on worker threads and streams them into their
+// textures on the render thread, so PNG decoding overlaps shader
+// compilation and a large texture arriving mid-session is spread over
+// several frames instead of causing a hitch.
+// Load() gives the texture a 1x1 placeholder at once so it can be bound
+// right away, and each Update() uploads at most the upload budget worth.
+// A cooked texture (CookedTexture.h) next to the image stays mapped and
+// goes up in rows straight from the mapping, smallest level first, each
+// completed level becoming the base level. Other images are copied row by
+// row through a pixel unpack buffer with glTexSubImage2D; while one
+// streams in, the placeholder sits in its smallest mip level with
+// GL_TEXTURE_BASE_LEVEL pointing there, so the partial level 0 is never
+// sampled, and one Update after the last slice the mip chain is generated
+// and the base level reset.
+class TextureLoader {
+public:
+  static const size_t DEFAULT_UPLOAD_BUDGET = 4 << 20;
+
+  // workerCount 0 uses one thread less than the hardware has, at least one
+  // ------------------------------------------------------------------------
+  explicit TextureLoader(unsigned int workerCount = 0) {
+    if (workerCount == 0) {
+      unsigned int hardware = std::thread::hardware_concurrency();
+      workerCount = hardware > 1 ? hardware - 1 : 1;
+    }
+    for (unsigned int i = 0; i < workerCount; ++i)
+      workers.emplace_back(&TextureLoader::WorkerLoop, this);
+  }
+  // stops the workers; call Destroy() first while the context is current
+  ~TextureLoader() { StopWorkers(); }
+  TextureLoader(const TextureLoader &) = delete;
+  TextureLoader &operator=(const TextureLoader &) = delete;
+
+  // bytes copied per Update, 0 for no limit; at least one row, or one row
+  // of blocks, always goes
+  void SetUploadBudget(size_t bytesPerFrame) { uploadBudget = bytesPerFrame; }
+
+  // render thread: gives texture the placeholder and queues the cooked
+  // version of path if there is one, else path itself for decoding; the
+  // texture must outlive its upload. Returns the video memory it will take
+  // once complete, estimated from the file headers
+  // ------------------------------------------------------------------------
+  size_t Load(unsigned int texture, const std::string &path) {
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, Placeholder());
+    size_t bytes;
+    bool cooked = QueueCooked(texture, CookedTexturePath(path), bytes);
+    if (!cooked) {
+      // RGBA8 plus a third for the mip chain; the placeholder stays if the
+      // file cannot be read
+      int width, height, channels;
+      bytes = stbi_info(path.c_str(), &width, &height, &channels)
+                  ? (size_t)width * height * 4 * 4 / 3
+                  : 4;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!cooked)
+        queued.push_back({texture, path, NULL, 0, 0, 0});
+      ++pending;
+    }
+    inFlight.insert(texture);
+    if (!cooked)
+      wake.notify_one();
+    return bytes;
+  }
+
+  // render thread: uploads the next slices within the budget and returns
+  // how many textures became complete
+  int Update() { return Pump(uploadBudget); }
+
+  // blocks until every queued texture is complete, ignoring the budget
+  void Finish() {
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (pending == 0)
+          return;
+        if (uploads.empty() && cookedUploads.empty() &&
+            mipmapQueue.empty())
+          decoded.wait(lock, [this] { return !finished.empty(); });
+      }
+      Pump(0);
+    }
+  }
+
+  // textures queued and not yet complete
+  size_t Pending() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending;
+  }
+  // render thread: whether texture was queued by Load and is not yet
+  // complete; such a texture must not be deleted
+  bool IsPending(unsigned int texture) const {
+    return inFlight.count(texture) != 0;
+  }
+
+  // current queue depths and the traffic since the previous call
+  // ------------------------------------------------------------------------
+  TextureStreamStats TakeStats() {
+    TextureStreamStats stats;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stats.uploadQueue = finished.size() + uploads.size() +
+                          cookedUploads.size() + mipmapQueue.size();
+      stats.decodeQueue = pending - stats.uploadQueue;
+    }
+    std::chrono::steady_clock::time_point now =
+        std::chrono::steady_clock::now();
+    stats.frames = statsFrames;
+    stats.texturesCompleted = statsCompleted;
+    stats.bytesUploaded = statsBytes;
+    stats.seconds = std::chrono::duration<double>(now - statsStart).count();
+    statsFrames = statsCompleted = 0;
+    statsBytes = 0;
+    statsStart = now;
+    return stats;
+  }
+
+  // stops the workers and releases the unpack buffer
+  void Destroy() {
+    StopWorkers();
+    if (unpackBuffer)
+      glDeleteBuffers(1, &unpackBuffer);
+    unpackBuffer = 0;
+  }
+
+private:
+  struct Job {
+    unsigned int texture;
+    std::string path;
+    unsigned char *pixels;
+    int width, height, channels;
+  };
+  // a decoded image being copied into its texture
+  struct Upload {
+    Job job;
+    GLenum format;
+    size_t rowBytes;
+    int nextRow;
+  };
+  // a mapped cooked texture whose levels are being uploaded
+  struct CookedUpload {
+    unsigned int texture;
+    std::unique_ptr<CookedTexture> file;
+    bool compressed; // blocks go to the GPU as they are
+    int nextLevel;   // counts down to 0; levels above it are uploaded
+    int nextRow;     // rows of nextLevel uploaded so far
+  };
+  // rows of one upload copied in the current Update
+  struct Slice {
+    Upload *upload;
+    int firstRow, rows;
+    size_t offset;
+  };
+
+  std::vector<std::thread> workers;
+  mutable std::mutex mutex;
+  std::condition_variable wake, decoded;
+  std::deque<Job> queued, finished;
+  size_t pending = 0;
+  bool stopping = false;
+
+  // render thread only
+  // textures queued by Load and not yet complete
+  std::unordered_set<unsigned int> inFlight;
+  std::deque<Upload> uploads;
+  std::deque<CookedUpload> cookedUploads;
+  // decoded cooked levels where S3TC is unavailable
+  std::vector<unsigned char> rgba;
+  // textures whose last slice went out in the previous Update
+  std::vector<unsigned int> mipmapQueue;
+  std::vector<Slice> slices;
+  size_t uploadBudget = DEFAULT_UPLOAD_BUDGET;
+  unsigned int unpackBuffer = 0;
+
+  unsigned int statsFrames = 0, statsCompleted = 0;
+  size_t statsBytes = 0;
+  std::chrono::steady_clock::time_point statsStart =
+      std::chrono::steady_clock::now();
+
+  // bytes a cooked level of the given format needs
+  static size_t CookedLevelSize(uint32_t format, int width, int height) {
+    if (format == COOKED_BC1)
+      return BlockCompressedSize(width, height, BLOCK_BC1);
+    if (format == COOKED_BC3)
+      return BlockCompressedSize(width, height, BLOCK_BC3);
+    return (size_t)width * height * 4;
+  }
+  // bytes a cooked level takes on the GPU: its blocks, or RGBA8 pixels
+  static size_t UploadedLevelSize(uint32_t format, bool compressed,
+                                  int width, int height) {
+    return compressed ? CookedLevelSize(format, width, height)
+                      : (size_t)width * height * 4;
+  }
+
+  // whether the context takes BC1/BC3 data as is; glad is generated
+  // without extension flags, so the extension list is searched once
+  static bool SupportsS3TC() {
+    static int supported = -1;
+    if (supported < 0) {
+      GLint count = 0;
+      glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+      supported = 0;
+      for (GLint i = 0; i < count && !supported; ++i) {
+        const char *name = (const char *)glGetStringi(GL_EXTENSIONS, i);
+        supported = name &&
+                    std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0;
+      }
+    }
+    return supported != 0;
+  }
+
+  // mid grey, so untextured objects are still lit sensibly
+  static const unsigned char *Placeholder() {
+    static const unsigned char pixel[4] = {128, 128, 128, 255};
+    return pixel;
+  }
+
+  // maps and validates a cooked file and queues its levels; false if it is
+  // missing or unusable, else bytes is the video memory it will take
+  // ------------------------------------------------------------------------
+  bool QueueCooked(unsigned int texture, const std::string &cookedPath,
+                   size_t &bytes) {
+    std::unique_ptr<CookedTexture> cooked(new CookedTexture);
+    if (!cooked->Open(cookedPath))
+      return false;
+    uint32_t format = cooked->Format();
+    if (format != COOKED_RGBA8 && format != COOKED_BC1 &&
+        format != COOKED_BC3) {
+      std::cout << "Unsupported cooked format: " << cookedPath << std::endl;
+      return false;
+    }
+    bool compressed = format != COOKED_RGBA8 && SupportsS3TC();
+    bytes = 0;
+    for (int i = 0; i < cooked->LevelCount(); ++i) {
+      CookedTexture::Level level = cooked->GetLevel(i);
+      if (level.size < CookedLevelSize(format, level.width, level.height)) {
+        std::cout << "Truncated cooked level " << i << ": " << cookedPath
+                  << std::endl;
+        return false;
+      }
+      bytes +=
+          UploadedLevelSize(format, compressed, level.width, level.height);
+    }
+    int lastLevel = cooked->LevelCount() - 1;
+    cookedUploads.push_back(
+        {texture, std::move(cooked), compressed, lastLevel, 0});
+    return true;
+  }
+
+  // uploads the next rows of a cooked texture that fit in room bytes,
+  // block-compressed where the driver supports S3TC and decoded to RGBA8
+  // otherwise, at least one band of rows if first is set; a level becomes
+  // the base level once complete. Returns the bytes uploaded
+  // ------------------------------------------------------------------------
+  size_t UploadCookedRows(CookedUpload &upload, size_t room, bool first) {
+    uint32_t format = upload.file->Format();
+    int i = upload.nextLevel;
+    CookedTexture::Level level = upload.file->GetLevel(i);
+    BlockFormat blockFormat = format == COOKED_BC1 ? BLOCK_BC1 : BLOCK_BC3;
+    // block-compressed levels go a row of blocks, four pixel rows, at a time
+    int bandRows = format == COOKED_RGBA8 ? 1 : 4;
+    size_t sourceBandBytes =
+        format == COOKED_RGBA8
+            ? (size_t)level.width * 4
+            : BlockCompressedSize(level.width, 4, blockFormat);
+    size_t bandBytes = upload.compressed
+                           ? sourceBandBytes
+                           : (size_t)level.width * bandRows * 4;
+    int bandsLeft = (level.height - upload.nextRow + bandRows - 1) / bandRows;
+    size_t fit = room / bandBytes;
+    int bands = fit < (size_t)bandsLeft ? (int)fit : bandsLeft;
+    if (bands == 0) {
+      if (!first)
+        return 0;
+      bands = 1;
+    }
+    int firstRow = upload.nextRow;
+    int rows = firstRow + bands * bandRows < level.height
+                   ? bands * bandRows
+                   : level.height - firstRow;
+    const unsigned char *source =
+        level.data + (size_t)(firstRow / bandRows) * sourceBandBytes;
+    GLenum compressedFormat = format == COOKED_BC1
+                                  ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                                  : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    int lastLevel = upload.file->LevelCount() - 1;
+
+    glBindTexture(GL_TEXTURE_2D, upload.texture);
+    if (i == lastLevel && firstRow == 0) {
+      // the whole chain is allocated largest first, replacing the
+      // placeholder, as Mesa drops some levels defined smallest first;
+      // texcook chains end at 1x1, a single band, so the base level gets
+      // its pixels below
+      for (int j = 0; j <= lastLevel; ++j) {
+        CookedTexture::Level other = upload.file->GetLevel(j);
+        if (upload.compressed)
+          glCompressedTexImage2D(
+              GL_TEXTURE_2D, j, compressedFormat, other.width, other.height,
+              0, (GLsizei)CookedLevelSize(format, other.width, other.height),
+              NULL);
+        else
+          glTexImage2D(GL_TEXTURE_2D, j, GL_RGBA8, other.width,
+                       other.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+      }
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, lastLevel);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, lastLevel);
+    }
+
+    size_t uploaded;
+    if (upload.compressed) {
+      uploaded = bands * sourceBandBytes;
+      glCompressedTexSubImage2D(GL_TEXTURE_2D, i, 0, firstRow, level.width,
+                                rows, compressedFormat, (GLsizei)uploaded,
+                                source);
+    } else {
+      if (format != COOKED_RGBA8) {
+        rgba.resize((size_t)level.width * rows * 4);
+        DecodeBlockImage(source, level.width, rows, blockFormat,
+                         rgba.data());
+        source = rgba.data();
+      }
+      uploaded = (size_t)level.width * rows * 4;
+      glTexSubImage2D(GL_TEXTURE_2D, i, 0, firstRow, level.width, rows,
+                      GL_RGBA, GL_UNSIGNED_BYTE, source);
+    }
+
+    upload.nextRow += rows;
+    if (upload.nextRow == level.height) {
+      // every level from here down is complete, so sampling can start here
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, i);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, lastLevel);
+      --upload.nextLevel;
+      upload.nextRow = 0;
+    }
+    return uploaded;
+  }
+
+  void WorkerLoop() {
+    for (;;) {
+      Job job;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [this] { return stopping || !queued.empty(); });
+        if (stopping)
+          return;
+        job = queued.front();
+        queued.pop_front();
+      }
+      job.pixels = stbi_load(job.path.c_str(), &job.width, &job.height,
+                             &job.channels, 0);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.push_back(job);
+      }
+      decoded.notify_all();
+    }
+  }
+
+  void StopWorkers() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers)
+      worker.join();
+    workers.clear();
+    for (Job &job : finished)
+      stbi_image_free(job.pixels);
+    for (Upload &upload : uploads)
+      stbi_image_free(upload.job.pixels);
+    finished.clear();
+    uploads.clear();
+    cookedUploads.clear();
+    queued.clear();
+    mipmapQueue.clear();
+    inFlight.clear();
+    pending = 0;
+  }
+
+  int Pump(size_t budget) {
+    PROFILE_GPU("texture upload");
+    ++statsFrames;
+
+    // the last slices of these went out a frame ago, so building the mip
+    // chain no longer waits on the transfer
+    int completed = (int)mipmapQueue.size();
+    for (unsigned int texture : mipmapQueue) {
+      glBindTexture(GL_TEXTURE_2D, texture);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+      glGenerateMipmap(GL_TEXTURE_2D);
+      inFlight.erase(texture);
+    }
+    mipmapQueue.clear();
+
+    std::deque<Job> ready;
+    size_t failed = 0;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      ready.swap(finished);
+    }
+    for (Job &job : ready) {
+      if (!job.pixels) {
+        // the placeholder stays
+        std::cout << "Texture failed to load at path: " << job.path
+                  << std::endl;
+        inFlight.erase(job.texture);
+        ++failed;
+        continue;
+      }
+      GLenum format = job.channels == 1   ? GL_RED
+                      : job.channels == 2 ? GL_RG
+                      : job.channels == 3 ? GL_RGB
+                                          : GL_RGBA;
+      uploads.push_back({job, format, (size_t)job.width * job.channels, 0});
+    }
+
+    // cooked levels go first, straight from the mapping, smallest level
+    // and oldest texture first; only the first band may exceed the budget
+    size_t cookedBytes = 0;
+    while (!cookedUploads.empty()) {
+      CookedUpload &upload = cookedUploads.front();
+      size_t room =
+          budget ? (cookedBytes < budget ? budget - cookedBytes : 0)
+                 : SIZE_MAX;
+      size_t bytes = UploadCookedRows(upload, room, cookedBytes == 0);
+      if (bytes == 0)
+        break;
+      cookedBytes += bytes;
+      if (upload.nextLevel < 0) {
+        inFlight.erase(upload.texture);
+        cookedUploads.pop_front(); // unmaps the file
+        ++completed;
+      }
+    }
+    statsBytes += cookedBytes;
+
+    // plan the rest of the budget as slices: whole rows, oldest texture
+    // first; only the frame's first upload may exceed the budget, by less
+    // than one row
+    slices.clear();
+    size_t used = 0;
+    for (Upload &upload : uploads) {
+      size_t spent = cookedBytes + used;
+      size_t room = budget ? (spent < budget ? budget - spent : 0) : SIZE_MAX;
+      int remaining = upload.job.height - upload.nextRow;
+      size_t fit = room / upload.rowBytes;
+      int rows = fit < (size_t)remaining ? (int)fit : remaining;
+      if (rows == 0) {
+        if (spent > 0)
+          break;
+        rows = 1;
+      }
+      slices.push_back({&upload, upload.nextRow, rows, used});
+      used += rows * upload.rowBytes;
+      if (budget && cookedBytes + used >= budget)
+        break;
+    }
+
+    if (!slices.empty()) {
+      // level 0 storage is allocated before the unpack buffer is bound
+      for (const Slice &slice : slices)
+        if (slice.firstRow == 0)
+          BeginUpload(*slice.upload);
+
+      // one orphaned unpack buffer holds every slice of this frame; client
+      // memory if it cannot be mapped
+      if (!unpackBuffer)
+        glGenBuffers(1, &unpackBuffer);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackBuffer);
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, used, NULL, GL_STREAM_DRAW);
+      unsigned char *mapped = (unsigned char *)glMapBufferRange(
+          GL_PIXEL_UNPACK_BUFFER, 0, used,
+          GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+      if (mapped) {
+        for (const Slice &slice : slices)
+          std::memcpy(mapped + slice.offset,
+                      slice.upload->job.pixels +
+                          slice.firstRow * slice.upload->rowBytes,
+                      slice.rows * slice.upload->rowBytes);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      } else {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      }
+
+      // rows of 1- and 3-channel images are not 4-byte aligned
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+      for (const Slice &slice : slices) {
+        Upload &upload = *slice.upload;
+        // with the unpack buffer bound the pointer is an offset into it
+        const void *source =
+            mapped ? (const void *)slice.offset
+                   : upload.job.pixels + slice.firstRow * upload.rowBytes;
+        glBindTexture(GL_TEXTURE_2D, upload.job.texture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, slice.firstRow,
+                        upload.job.width, slice.rows, upload.format,
+                        GL_UNSIGNED_BYTE, source);
+        upload.nextRow += slice.rows;
+      }
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+      // other uploads read from client memory
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      statsBytes += used;
+    }
+
+    // uploads complete in order, so the finished ones are at the front
+    while (!uploads.empty() &&
+           uploads.front().nextRow == uploads.front().job.height) {
+      stbi_image_free(uploads.front().job.pixels);
+      mipmapQueue.push_back(uploads.front().job.texture);
+      uploads.pop_front();
+    }
+
+    statsCompleted += completed;
+    std::lock_guard<std::mutex> lock(mutex);
+    pending -= completed + failed;
+    return completed;
+  }
+
+  // allocates level 0 and moves the placeholder to the 1x1 mip level
+  void BeginUpload(const Upload &upload) {
+    const Job &job = upload.job;
+    int lastLevel = 0;
+    for (int size = job.width > job.height ? job.width : job.height;
+         size > 1; size >>= 1)
+      ++lastLevel;
+    glBindTexture(GL_TEXTURE_2D, job.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, upload.format, job.width, job.height, 0,
+                 upload.format, GL_UNSIGNED_BYTE, NULL);
+    if (lastLevel > 0) {
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+      glTexImage2D(GL_TEXTURE_2D, lastLevel, upload.format, 1, 1, 0,
+                   upload.format, GL_UNSIGNED_BYTE, Placeholder());
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, lastLevel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, lastLevel);
+  }
+};
+
+#endif
@@ -8,15 +8,27 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "Camera.h"
+#include "CommandBucket.h"
+#include "FrameBench.h"
+#include "FrameUniforms.h"
+#include "Headless.h"
+#include "Profiler.h"
+#include "RingBuffer.h"
 #include "Shader.h"
+#include "TextureCache.h"
+#include "TextureLoader.h"
 
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <string>
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 void mouse_callback(GLFWwindow *window, double xpos, double ypos);
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
-unsigned int loadTexture(const char *path);
+TextureHandle loadTexture(TextureCache &cache, const char *path);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
@@ -35,41 +47,135 @@ float lastFrame = 0.0f;
 // lighting
 glm::vec3 lightPos(1.2f, 1.0f, 2.0f);
 
-int main() {
-  // glfw: initialize and configure
-  // ------------------------------
-  glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+// one recorded draw of the render loop; texture names are 0 for untextured
+// objects
+struct ObjectDraw {
+  const Shader *shader;
+  unsigned int vao;
+  size_t uniformOffset;
+  unsigned int diffuseMap, specularMap;
+};
+
+// adds a draw keyed by its state and the view-space position of its origin
+void RecordDraw(CommandBucket<ObjectDraw> &bucket, const ObjectDraw &draw,
+                const glm::vec4 &viewOrigin) {
+  bucket.Add(MakeSortKey(draw.shader->ID, draw.diffuseMap, draw.vao,
+                         -viewOrigin.z),
+             draw);
+}
 
-  // glfw window creation
-  // --------------------
-  GLFWwindow *window =
-      glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "GL Test Window", NULL, NULL);
-  if (window == NULL) {
-    std::cout << "Failed to create GLFW window" << std::endl;
-    glfwTerminate();
-    return -1;
+int main(int argc, char **argv) {
+  // --headless renders offscreen without a display and exits after
+  // --frames=N frames
+  // --bench steps a fixed clock and writes frame timings to --bench-report
+  // (.json summary or .csv samples) after --bench-warmup and
+  // --bench-frames frames
+  // --profile prints per-scope CPU/GPU times once a second; with
+  // --profile=trace.json it also writes a Chrome trace on exit
+  // --upload-budget=KB caps the texture bytes uploaded per frame (0: none)
+  // --texture-budget=MB is the video memory unused textures may keep
+  bool headless = false, benchMode = false, profile = false;
+  long frameLimit = 300;
+  int benchWarmup = 100, benchFrames = 1000;
+  std::string benchReport = "bench.json", profileTrace;
+  size_t uploadBudget = TextureLoader::DEFAULT_UPLOAD_BUDGET;
+  size_t textureBudget = TextureCache::DEFAULT_BUDGET;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--headless") == 0)
+      headless = true;
+    else if (std::strncmp(argv[i], "--frames=", 9) == 0)
+      frameLimit = std::atol(argv[i] + 9);
+    else if (std::strcmp(argv[i], "--bench") == 0)
+      benchMode = true;
+    else if (std::strncmp(argv[i], "--bench-warmup=", 15) == 0)
+      benchWarmup = std::atoi(argv[i] + 15);
+    else if (std::strncmp(argv[i], "--bench-frames=", 15) == 0)
+      benchFrames = std::atoi(argv[i] + 15);
+    else if (std::strncmp(argv[i], "--bench-report=", 15) == 0)
+      benchReport = argv[i] + 15;
+    else if (std::strncmp(argv[i], "--upload-budget=", 16) == 0)
+      uploadBudget = (size_t)std::atol(argv[i] + 16) * 1024;
+    else if (std::strncmp(argv[i], "--texture-budget=", 17) == 0)
+      textureBudget = (size_t)std::atol(argv[i] + 17) << 20;
+    else if (std::strcmp(argv[i], "--profile") == 0)
+      profile = true;
+    else if (std::strncmp(argv[i], "--profile=", 10) == 0) {
+      profile = true;
+      profileTrace = argv[i] + 10;
+    }
   }
-  glfwMakeContextCurrent(window);
-  glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-  glfwSetCursorPosCallback(window, mouse_callback);
-  glfwSetScrollCallback(window, scroll_callback);
-
-  // tell GLFW to capture our mouse
-  glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-  // glad: load all OpenGL function pointers
-  // ---------------------------------------
-  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-    std::cout << "Failed to initialize GLAD" << std::endl;
+  // the report needs at least one measured frame
+  if (benchFrames < 1 || benchWarmup < 0) {
+    std::cout << "Usage: --bench-frames=N with N >= 1, --bench-warmup=N "
+                 "with N >= 0"
+              << std::endl;
     return -1;
   }
 
+  GLFWwindow *window = NULL;
+  HeadlessContext offscreen;
+  if (headless) {
+    // no window system at all: EGL/OSMesa context rendering into an FBO
+    if (!offscreen.Create(SCR_WIDTH, SCR_HEIGHT) ||
+        !gladLoadGLLoader((GLADloadproc)HeadlessContext::GetProcAddress)) {
+      std::cout << "Failed to initialize headless GL" << std::endl;
+      return -1;
+    }
+    offscreen.CreateFramebuffer();
+  } else {
+    // glfw: initialize and configure
+    // ------------------------------
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    // glfw window creation
+    // --------------------
+    window =
+        glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "GL Test Window", NULL, NULL);
+    if (window == NULL) {
+      std::cout << "Failed to create GLFW window" << std::endl;
+      glfwTerminate();
+      return -1;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+
+    // tell GLFW to capture our mouse
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    // glad: load all OpenGL function pointers
+    // ---------------------------------------
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+      std::cout << "Failed to initialize GLAD" << std::endl;
+      return -1;
+    }
+    // measure rendering, not the display's refresh rate
+    if (benchMode)
+      glfwSwapInterval(0);
+  }
+
   // configure global opengl state
   // -----------------------------
   glEnable(GL_DEPTH_TEST);
+  // before the shaders and textures, so their loading is timed too
+  if (profile)
+    Profiler::Instance().Enable(!profileTrace.empty());
+
+  // load textures (we now use a utility function to keep the code more
+  // organized); queued before the shaders so decoding overlaps their
+  // compilation, with a placeholder bound until each image arrives
+  // -----------------------------------------------------------------------------
+  TextureLoader textureLoader;
+  textureLoader.SetUploadBudget(uploadBudget);
+  TextureCache textureCache(textureLoader, textureBudget);
+  TextureHandle diffuseMap =
+      loadTexture(textureCache, "Textures/container2.png");
+  TextureHandle specularMap =
+      loadTexture(textureCache, "Textures/container2_specular.png");
 
   // build and compile our shader zprogram
   // ------------------------------------
@@ -146,40 +252,77 @@ int main() {
   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
   glEnableVertexAttribArray(0);
 
-  // load textures (we now use a utility function to keep the code more
-  // organized)
-  // -----------------------------------------------------------------------------
-  unsigned int diffuseMap = loadTexture("Textures/container2.png");
-  unsigned int specularMap = loadTexture("Textures/container2_specular.png");
-
   // shader configuration
   // --------------------
   lightingShader.use();
   lightingShader.setInt("material.diffuse", 0);
   lightingShader.setInt("material.specular", 1);
 
+  // both programs read view/projection/viewPos/lightPos from one buffer
+  FrameUniforms frameUniforms;
+  lightingShader.bindUniformBlock("FrameUniforms", FrameUniforms::BINDING);
+  lightCubeShader.bindUniformBlock("FrameUniforms", FrameUniforms::BINDING);
+
+  // per-object transforms are streamed through a ring of uniform ranges
+  // instead of glUniform calls
+  lightingShader.bindUniformBlock("ObjectUniforms", OBJECT_UNIFORMS_BINDING);
+  lightCubeShader.bindUniformBlock("ObjectUniforms", OBJECT_UNIFORMS_BINDING);
+  GLint uniformAlignment = 256;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+  const size_t OBJECTS_PER_FRAME = 2;
+  RingBuffer objectRing(GL_UNIFORM_BUFFER,
+                        OBJECTS_PER_FRAME * (sizeof(ObjectData) +
+                                             (size_t)uniformAlignment));
+  float lastStatsTime = 0.0f;
+  CommandBucket<ObjectDraw> drawBucket;
+  std::unique_ptr<FrameBench> bench;
+  if (benchMode)
+    bench.reset(new FrameBench(benchWarmup, benchFrames));
+
   // render loop
   // -----------
-  while (!glfwWindowShouldClose(window)) {
-    // per-frame time logic
+  for (long frameCount = 0;
+       bench      ? !bench->Done()
+       : headless ? frameCount < frameLimit
+                  : !glfwWindowShouldClose(window);
+       ++frameCount) {
+    // per-frame time logic; benchmarks run on simulated time so every run
+    // draws the same frames
     // --------------------
-    float currentFrame = static_cast<float>(glfwGetTime());
+    float currentFrame = static_cast<float>(
+        bench ? bench->Time() : headless ? offscreen.GetTime() : glfwGetTime());
     deltaTime = currentFrame - lastFrame;
     lastFrame = currentFrame;
 
-    // input
+    // input; the camera stays put while benchmarking
     // -----
-    processInput(window);
+    if (!headless && !bench)
+      processInput(window);
+    if (bench)
+      bench->BeginFrame();
+    Profiler::Instance().BeginFrame();
+    textureLoader.Update();
+    textureCache.Trim();
 
     // render
     // ------
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    // view/projection transformations and light position, shared by both
+    // programs through the uniform buffer
+    FrameData frame;
+    frame.projection =
+        glm::perspective(glm::radians(camera.Zoom),
+                         (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+    frame.view = camera.GetViewMatrix();
+    frame.viewPos = glm::vec4(camera.Position, 1.0f);
+    frame.lightPos = glm::vec4(lightPos, 1.0f);
+    frame.lightColor = glm::vec4(1.0f);
+    frameUniforms.Update(frame);
+
     // be sure to activate shader when setting uniforms/drawing objects
     lightingShader.use();
-    lightingShader.setVec3("light.position", lightPos);
-    lightingShader.setVec3("viewPos", camera.Position);
 
     // light properties
     lightingShader.setVec3("light.ambient", glm::vec3(0.2f, 0.2f, 0.2f));
@@ -189,56 +332,130 @@ int main() {
     // material properties
     lightingShader.setFloat("material.shininess", 64.0f);
 
-    // view/projection transformations
-    glm::mat4 projection =
-        glm::perspective(glm::radians(camera.Zoom),
-                         (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-    glm::mat4 view = camera.GetViewMatrix();
-    lightingShader.setMat4("projection", projection);
-    lightingShader.setMat4("view", view);
-
-    // world transformation
-    glm::mat4 model = glm::mat4(1.0f);
-    lightingShader.setMat4("model", model);
-
-    // bind diffuse map
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, diffuseMap);
-
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, specularMap);
-    // render the cube
-    glBindVertexArray(cubeVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-
-    // also draw the lamp object
-    lightCubeShader.use();
-    lightCubeShader.setMat4("projection", projection);
-    lightCubeShader.setMat4("view", view);
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, lightPos);
-    model = glm::scale(model, glm::vec3(0.2f)); // a smaller cube
-    lightCubeShader.setMat4("model", model);
-
-    glBindVertexArray(lightCubeVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
+    // world transformations for both objects, written before any draw
+    // reads from this frame's region
+    glm::mat4 cubeModel = glm::mat4(1.0f);
+    glm::mat4 lampModel = glm::mat4(1.0f);
+    lampModel = glm::translate(lampModel, lightPos);
+    lampModel = glm::scale(lampModel, glm::vec3(0.2f)); // a smaller cube
+    objectRing.BeginFrame();
+    size_t cubeOffset, lampOffset;
+    ObjectData *cube = (ObjectData *)objectRing.Allocate(
+        sizeof(ObjectData), uniformAlignment, cubeOffset);
+    ObjectData *lamp = (ObjectData *)objectRing.Allocate(
+        sizeof(ObjectData), uniformAlignment, lampOffset);
+    // NULL when the ring failed to map; the frame is then drawn empty
+    bool objectsWritten = cube != NULL && lamp != NULL;
+    if (objectsWritten) {
+      cube->model = cubeModel;
+      // normal matrix computed once per object instead of once per vertex
+      cube->normalMatrix =
+          glm::mat4(glm::transpose(glm::inverse(glm::mat3(cubeModel))));
+      lamp->model = lampModel;
+      lamp->normalMatrix = glm::mat4(1.0f);
+    }
+    objectRing.FinishWrites();
+
+    // record both draws, then submit them grouped by program and front to
+    // back within each group; depths come from the local matrices, since
+    // the mapped buffer is write-combined and may already be unmapped
+    glm::mat4 view = frame.view;
+    drawBucket.Clear();
+    if (objectsWritten) {
+      RecordDraw(drawBucket, {&lightingShader, cubeVAO, cubeOffset,
+                              diffuseMap.Id(), specularMap.Id()},
+                 view * cubeModel[3]);
+      RecordDraw(drawBucket,
+                 {&lightCubeShader, lightCubeVAO, lampOffset, 0, 0},
+                 view * lampModel[3]);
+    }
+    drawBucket.Sort();
+
+    const Shader *boundShader = &lightingShader;
+    {
+      PROFILE_GPU("draw objects");
+      drawBucket.Submit([&](const ObjectDraw &draw) {
+        if (draw.shader != boundShader) {
+          draw.shader->use();
+          boundShader = draw.shader;
+        }
+        if (draw.diffuseMap) {
+          glActiveTexture(GL_TEXTURE0);
+          glBindTexture(GL_TEXTURE_2D, draw.diffuseMap);
+          glActiveTexture(GL_TEXTURE1);
+          glBindTexture(GL_TEXTURE_2D, draw.specularMap);
+        }
+        glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_UNIFORMS_BINDING,
+                          objectRing.Buffer(), draw.uniformOffset,
+                          sizeof(ObjectData));
+        glBindVertexArray(draw.vao);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+      });
+    }
+    objectRing.EndFrame();
+
+    // report once a second if the CPU had to wait for the GPU to release
+    // a ring region
+    if (currentFrame - lastStatsTime >= 1.0f) {
+      RingWaitStats waits = objectRing.TakeWaitStats();
+      if (waits.stalledFrames > 0)
+        std::cout << "ring buffer: stalled " << waits.stalledFrames << "/"
+                  << waits.frames << " frames, " << waits.totalMs
+                  << " ms total, " << waits.maxMs << " ms max" << std::endl;
+      // texture streaming progress, while there is any
+      TextureStreamStats streaming = textureLoader.TakeStats();
+      if (streaming.decodeQueue + streaming.uploadQueue > 0 ||
+          streaming.bytesUploaded > 0)
+        std::cout << "texture streaming: " << streaming.decodeQueue
+                  << " decoding, " << streaming.uploadQueue << " uploading, "
+                  << streaming.texturesCompleted << " completed, "
+                  << streaming.MegabytesPerSecond() << " MB/s" << std::endl;
+      // totals of the frame whose GPU queries were collected last
+      for (const ProfileScopeStats &scope : Profiler::Instance().LastFrame())
+        std::cout << scope.name << ": cpu " << scope.cpuMs << " ms, gpu "
+                  << scope.gpuMs << " ms, " << scope.calls << " calls"
+                  << std::endl;
+      lastStatsTime = currentFrame;
+    }
 
     // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved
     // etc.)
     // -------------------------------------------------------------------------------
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    if (bench)
+      bench->EndFrame();
+    if (headless) {
+      offscreen.EndFrame();
+    } else {
+      glfwSwapBuffers(window);
+      glfwPollEvents();
+    }
+  }
+
+  if (bench) {
+    if (bench->WriteReport(benchReport, "LearnOpenGL"))
+      std::cout << "Benchmark report written to " << benchReport << std::endl;
+    bench.reset();
+  }
+  if (profile) {
+    if (!profileTrace.empty() &&
+        Profiler::Instance().WriteTrace(profileTrace))
+      std::cout << "Profiler trace written to " << profileTrace << std::endl;
+    Profiler::Instance().Destroy();
   }
 
   // optional: de-allocate all resources once they've outlived their purpose:
   // ------------------------------------------------------------------------
+  textureCache.Destroy();
+  textureLoader.Destroy();
+  objectRing.Destroy();
   glDeleteVertexArrays(1, &cubeVAO);
   glDeleteVertexArrays(1, &lightCubeVAO);
   glDeleteBuffers(1, &VBO);
 
   // glfw: terminate, clearing all previously allocated GLFW resources.
   // ------------------------------------------------------------------
-  glfwTerminate();
+  if (!headless)
+    glfwTerminate();
   return 0;
 }
 
@@ -298,36 +515,15 @@ void scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
 
 // utility function for loading a 2D texture from file
 // ---------------------------------------------------
-unsigned int loadTexture(char const *path) {
-  unsigned int textureID;
-  glGenTextures(1, &textureID);
-
-  int width, height, nrComponents;
-  unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-  if (data) {
-    GLenum format;
-    if (nrComponents == 1)
-      format = GL_RED;
-    else if (nrComponents == 3)
-      format = GL_RGB;
-    else if (nrComponents == 4)
-      format = GL_RGBA;
-
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format,
-                 GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-                    GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    stbi_image_free(data);
-  } else {
-    std::cout << "Texture failed to load at path: " << path << std::endl;
-    stbi_image_free(data);
-  }
-  return textureID;
+TextureHandle loadTexture(TextureCache &cache, char const *path) {
+  PROFILE_CPU("loadTexture");
+  // repeat wrapping, trilinear filtering; shared with every other user of
+  // the file, and decoded on a worker thread and uploaded by
+  // loader.Update() the first time
+  SamplerKey sampler;
+  sampler.wrapS = GL_REPEAT;
+  sampler.wrapT = GL_REPEAT;
+  sampler.minFilter = GL_LINEAR_MIPMAP_LINEAR;
+  sampler.magFilter = GL_LINEAR;
+  return cache.Acquire(path, sampler);
 }
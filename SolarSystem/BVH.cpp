@@ -0,0 +1,280 @@
+#include "BVH.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+
+// Bodies per leaf; small leaves keep the per-sphere tests cheap.
+const unsigned int LEAF_SIZE = 4;
+
+// Rebuild once refitted boxes cover this much more area than when built.
+const float REBUILD_RATIO = 2.0f;
+
+float SurfaceArea(const glm::vec3 &min, const glm::vec3 &max) {
+  glm::vec3 d = max - min;
+  return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+// Distance along the ray to the box, or FLT_MAX when it misses.
+float RayBox(glm::vec3 origin, glm::vec3 invDir, const glm::vec3 &min,
+             const glm::vec3 &max) {
+  float enter = 0.0f, exit = FLT_MAX;
+  for (int axis = 0; axis < 3; ++axis) {
+    // a ray parallel to the slab never crosses it; the slab test would
+    // give 0 * inf = NaN for an origin on one of its faces
+    if (std::isinf(invDir[axis])) {
+      if (origin[axis] < min[axis] || origin[axis] > max[axis])
+        return FLT_MAX;
+      continue;
+    }
+    float t0 = (min[axis] - origin[axis]) * invDir[axis];
+    float t1 = (max[axis] - origin[axis]) * invDir[axis];
+    enter = std::max(enter, std::min(t0, t1));
+    exit = std::min(exit, std::max(t0, t1));
+  }
+  return enter <= exit ? enter : FLT_MAX;
+}
+
+// Distance along the ray to the sphere surface, or FLT_MAX when it misses.
+float RaySphere(glm::vec3 origin, glm::vec3 dir, glm::vec3 center,
+                float radius) {
+  glm::vec3 oc = origin - center;
+  float b = glm::dot(oc, dir);
+  float c = glm::dot(oc, oc) - radius * radius;
+  float disc = b * b - c;
+  if (disc < 0.0f)
+    return FLT_MAX;
+  float sq = std::sqrt(disc);
+  float t = -b - sq;
+  if (t < 0.0f)
+    t = -b + sq; // origin inside the sphere
+  return t >= 0.0f ? t : FLT_MAX;
+}
+
+float PointBoxDistance(glm::vec3 p, const glm::vec3 &min,
+                       const glm::vec3 &max) {
+  glm::vec3 d = glm::max(glm::max(min - p, p - max), glm::vec3(0.0f));
+  return glm::length(d);
+}
+
+} // namespace
+
+void BodyBVH::FitLeaf(const BodyStore &bodies, Node &node) const {
+  node.min = glm::vec3(FLT_MAX);
+  node.max = glm::vec3(-FLT_MAX);
+  for (unsigned int i = node.first; i < node.first + node.count; ++i) {
+    unsigned int body = indices[i];
+    glm::vec3 r(bodies.size[body]);
+    node.min = glm::min(node.min, bodies.position[body] - r);
+    node.max = glm::max(node.max, bodies.position[body] + r);
+  }
+}
+
+void BodyBVH::Build(const BodyStore &bodies) {
+  size_t count = bodies.Size();
+  indices.resize(count);
+  for (size_t i = 0; i < count; ++i)
+    indices[i] = (unsigned int)i;
+
+  nodes.clear();
+  if (count == 0) {
+    builtArea = 0.0f;
+    return;
+  }
+  nodes.reserve(2 * count);
+  nodes.push_back({glm::vec3(0.0f), glm::vec3(0.0f), 0, (unsigned int)count,
+                   -1});
+  Subdivide(bodies, 0);
+  builtArea = TotalArea();
+}
+
+void BodyBVH::Subdivide(const BodyStore &bodies, int nodeIndex) {
+  FitLeaf(bodies, nodes[nodeIndex]);
+  Node node = nodes[nodeIndex];
+  if (node.count <= LEAF_SIZE)
+    return;
+
+  // split at the median centroid along the widest axis
+  glm::vec3 cMin(FLT_MAX), cMax(-FLT_MAX);
+  for (unsigned int i = node.first; i < node.first + node.count; ++i) {
+    cMin = glm::min(cMin, bodies.position[indices[i]]);
+    cMax = glm::max(cMax, bodies.position[indices[i]]);
+  }
+  glm::vec3 extent = cMax - cMin;
+  int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2)
+                                 : (extent.y > extent.z ? 1 : 2);
+
+  unsigned int half = node.count / 2;
+  auto begin = indices.begin() + node.first;
+  std::nth_element(begin, begin + half, begin + node.count,
+                   [&](unsigned int a, unsigned int b) {
+                     return bodies.position[a][axis] <
+                            bodies.position[b][axis];
+                   });
+
+  int left = (int)nodes.size();
+  nodes[nodeIndex].left = left;
+  nodes.push_back({glm::vec3(0.0f), glm::vec3(0.0f), node.first, half, -1});
+  nodes.push_back({glm::vec3(0.0f), glm::vec3(0.0f), node.first + half,
+                   node.count - half, -1});
+  Subdivide(bodies, left);
+  Subdivide(bodies, left + 1);
+}
+
+void BodyBVH::Refit(const BodyStore &bodies) {
+  if (indices.size() != bodies.Size()) {
+    Build(bodies);
+    return;
+  }
+  // children are always stored after their parent, so a reverse sweep
+  // visits every child before the node that encloses it
+  for (size_t n = nodes.size(); n-- > 0;) {
+    Node &node = nodes[n];
+    if (node.left < 0) {
+      FitLeaf(bodies, node);
+    } else {
+      const Node &a = nodes[node.left], &b = nodes[node.left + 1];
+      node.min = glm::min(a.min, b.min);
+      node.max = glm::max(a.max, b.max);
+    }
+  }
+  if (TotalArea() > REBUILD_RATIO * builtArea)
+    Build(bodies);
+}
+
+float BodyBVH::TotalArea() const {
+  float area = 0.0f;
+  for (const Node &node : nodes)
+    area += SurfaceArea(node.min, node.max);
+  return area;
+}
+
+size_t BodyBVH::QueryFrustum(const BodyStore &bodies, const Frustum &frustum,
+                             unsigned char *visible) const {
+  std::fill(visible, visible + bodies.Size(), 0);
+  if (nodes.empty())
+    return 0;
+
+  size_t visibleCount = 0;
+  std::vector<int> stack;
+  stack.push_back(0);
+  while (!stack.empty()) {
+    const Node &node = nodes[stack.back()];
+    stack.pop_back();
+
+    // classify the box against each plane using its nearest and farthest
+    // corners along the plane normal
+    bool outside = false, inside = true;
+    for (const glm::vec4 &p : frustum.planes) {
+      glm::vec3 far(p.x >= 0 ? node.max.x : node.min.x,
+                    p.y >= 0 ? node.max.y : node.min.y,
+                    p.z >= 0 ? node.max.z : node.min.z);
+      glm::vec3 near(p.x >= 0 ? node.min.x : node.max.x,
+                     p.y >= 0 ? node.min.y : node.max.y,
+                     p.z >= 0 ? node.min.z : node.max.z);
+      if (glm::dot(glm::vec3(p), far) + p.w < 0.0f) {
+        outside = true;
+        break;
+      }
+      if (glm::dot(glm::vec3(p), near) + p.w < 0.0f)
+        inside = false;
+    }
+    if (outside)
+      continue;
+
+    if (inside) {
+      for (unsigned int i = node.first; i < node.first + node.count; ++i)
+        visible[indices[i]] = 1;
+      visibleCount += node.count;
+    } else if (node.left < 0) {
+      for (unsigned int i = node.first; i < node.first + node.count; ++i) {
+        unsigned int body = indices[i];
+        if (frustum.IntersectsSphere(bodies.position[body],
+                                     bodies.size[body])) {
+          visible[body] = 1;
+          ++visibleCount;
+        }
+      }
+    } else {
+      stack.push_back(node.left);
+      stack.push_back(node.left + 1);
+    }
+  }
+  return visibleCount;
+}
+
+int BodyBVH::Raycast(const BodyStore &bodies, glm::vec3 origin,
+                     glm::vec3 dir, float &hitDistance) const {
+  int hit = -1;
+  hitDistance = FLT_MAX;
+  if (nodes.empty())
+    return hit;
+
+  glm::vec3 invDir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+  std::vector<int> stack;
+  stack.push_back(0);
+  while (!stack.empty()) {
+    const Node &node = nodes[stack.back()];
+    stack.pop_back();
+    if (RayBox(origin, invDir, node.min, node.max) >= hitDistance)
+      continue;
+
+    if (node.left < 0) {
+      for (unsigned int i = node.first; i < node.first + node.count; ++i) {
+        unsigned int body = indices[i];
+        float t = RaySphere(origin, dir, bodies.position[body],
+                            bodies.size[body]);
+        if (t < hitDistance) {
+          hitDistance = t;
+          hit = (int)body;
+        }
+      }
+    } else {
+      stack.push_back(node.left);
+      stack.push_back(node.left + 1);
+    }
+  }
+  return hit;
+}
+
+int BodyBVH::Nearest(const BodyStore &bodies, glm::vec3 point,
+                     float &distance) const {
+  int nearest = -1;
+  distance = FLT_MAX;
+  if (nodes.empty())
+    return nearest;
+
+  std::vector<int> stack;
+  stack.push_back(0);
+  while (!stack.empty()) {
+    const Node &node = nodes[stack.back()];
+    stack.pop_back();
+    // boxes include the radii, so this bounds every surface inside. A point
+    // inside overlapping spheres has a negative best distance, while a box
+    // around the point is at 0 and may still hold a deeper sphere
+    if (PointBoxDistance(point, node.min, node.max) >
+        std::max(distance, 0.0f))
+      continue;
+
+    if (node.left < 0) {
+      for (unsigned int i = node.first; i < node.first + node.count; ++i) {
+        unsigned int body = indices[i];
+        float d = glm::length(point - bodies.position[body]) -
+                  bodies.size[body];
+        if (d < distance) {
+          distance = d;
+          nearest = (int)body;
+        }
+      }
+    } else {
+      // visit the closer child first so its result prunes the other
+      const Node &a = nodes[node.left], &b = nodes[node.left + 1];
+      bool leftFirst = PointBoxDistance(point, a.min, a.max) <
+                       PointBoxDistance(point, b.min, b.max);
+      stack.push_back(leftFirst ? node.left + 1 : node.left);
+      stack.push_back(leftFirst ? node.left : node.left + 1);
+    }
+  }
+  return nearest;
+}
@@ -0,0 +1,51 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "BodyStore.h"
+#include "Frustum.h"
+#include <vector>
+
+// Bounding volume hierarchy over body bounding spheres. Build() sorts the
+// bodies into a binary tree by median split; Refit() only recomputes the
+// boxes after bodies move, and rebuilds once the tree has grown too loose.
+class BodyBVH {
+public:
+  void Build(const BodyStore &bodies);
+  void Refit(const BodyStore &bodies);
+
+  // Writes visible[i] for every body (1 = may be on screen) and returns the
+  // visible count. Subtrees fully inside or outside the frustum are
+  // resolved without touching their bodies.
+  size_t QueryFrustum(const BodyStore &bodies, const Frustum &frustum,
+                      unsigned char *visible) const;
+
+  // Closest body hit by the ray, or -1. dir must be normalized.
+  int Raycast(const BodyStore &bodies, glm::vec3 origin, glm::vec3 dir,
+              float &hitDistance) const;
+
+  // Body whose surface is closest to point, or -1 if there are no bodies.
+  int Nearest(const BodyStore &bodies, glm::vec3 point,
+              float &distance) const;
+
+  size_t NodeCount() const { return nodes.size(); }
+
+private:
+  struct Node {
+    glm::vec3 min, max;
+    // bodies of the whole subtree are indices[first, first + count)
+    unsigned int first, count;
+    // children are nodes[left] and nodes[left + 1]; -1 for a leaf
+    int left;
+  };
+
+  std::vector<Node> nodes;
+  std::vector<unsigned int> indices;
+  // summed surface area of the boxes right after the last Build
+  float builtArea = 0.0f;
+
+  void Subdivide(const BodyStore &bodies, int nodeIndex);
+  void FitLeaf(const BodyStore &bodies, Node &node) const;
+  float TotalArea() const;
+};
+
+#endif
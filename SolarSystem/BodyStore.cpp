@@ -0,0 +1,26 @@
+#include "BodyStore.h"
+
+void BodyStore::Reserve(size_t count) {
+  orbitRadius.reserve(count);
+  orbitSpeed.reserve(count);
+  size.reserve(count);
+  color.reserve(count);
+  position.reserve(count);
+}
+
+void BodyStore::Add(float radius, float speed, float bodySize,
+                    glm::vec3 bodyColor) {
+  orbitRadius.push_back(radius);
+  orbitSpeed.push_back(speed);
+  size.push_back(bodySize);
+  color.push_back(bodyColor);
+  position.push_back(glm::vec3(radius, 0.0f, 0.0f));
+}
+
+void BodyStore::Clear() {
+  orbitRadius.clear();
+  orbitSpeed.clear();
+  size.clear();
+  color.clear();
+  position.clear();
+}
@@ -0,0 +1,39 @@
+#ifndef BODY_STORE_H
+#define BODY_STORE_H
+
+#include "BodyTable.h"
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Structure-of-arrays storage for orbiting bodies. Every field lives in its
+// own contiguous array, so per-frame kernels stream only the data they use
+// and the arrays can be uploaded to instance buffers as they are.
+class BodyStore {
+public:
+  std::vector<float> orbitRadius, orbitSpeed, size;
+  std::vector<glm::vec3> color;
+  std::vector<glm::vec3> position;
+
+  size_t Size() const { return position.size(); }
+  void Reserve(size_t count);
+  void Add(float orbitRadius, float orbitSpeed, float size, glm::vec3 color);
+  // Replaces every body with the table's, one exact-size copy per array.
+  template <size_t N> void Assign(const BodyTable<N> &table);
+  void Clear();
+};
+
+template <size_t N> void BodyStore::Assign(const BodyTable<N> &table) {
+  orbitRadius.assign(table.orbitRadius, table.orbitRadius + N);
+  orbitSpeed.assign(table.orbitSpeed, table.orbitSpeed + N);
+  size.assign(table.size, table.size + N);
+  color.resize(N);
+  position.resize(N);
+  for (size_t i = 0; i < N; ++i) {
+    color[i] = glm::vec3(table.color[i][0], table.color[i][1],
+                         table.color[i][2]);
+    position[i] = glm::vec3(table.orbitRadius[i], 0.0f, 0.0f);
+  }
+}
+
+#endif
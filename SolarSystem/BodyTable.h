@@ -0,0 +1,34 @@
+#ifndef BODY_TABLE_H
+#define BODY_TABLE_H
+
+#include <cstddef>
+
+// One body as written in scene tables and scene files.
+struct BodyDesc {
+  float orbitRadius, orbitSpeed, size;
+  float r, g, b;
+};
+
+// Compile-time structure-of-arrays copy of a BodyDesc list, laid out like
+// BodyStore, so BodyStore::Assign copies whole arrays.
+template <size_t N> struct BodyTable {
+  static const size_t COUNT = N;
+  float orbitRadius[N], orbitSpeed[N], size[N];
+  float color[N][3];
+};
+
+template <size_t N>
+constexpr BodyTable<N> MakeBodyTable(const BodyDesc (&bodies)[N]) {
+  BodyTable<N> table{};
+  for (size_t i = 0; i < N; ++i) {
+    table.orbitRadius[i] = bodies[i].orbitRadius;
+    table.orbitSpeed[i] = bodies[i].orbitSpeed;
+    table.size[i] = bodies[i].size;
+    table.color[i][0] = bodies[i].r;
+    table.color[i][1] = bodies[i].g;
+    table.color[i][2] = bodies[i].b;
+  }
+  return table;
+}
+
+#endif
@@ -0,0 +1,123 @@
+#include "FrameBench.h"
+#include "glad/glad.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+struct Summary {
+  double mean, p50, p95, p99;
+};
+
+// Nearest-rank percentiles of the samples.
+Summary Summarize(std::vector<double> samples) {
+  Summary s = {0.0, 0.0, 0.0, 0.0};
+  if (samples.empty())
+    return s;
+  std::sort(samples.begin(), samples.end());
+  for (double v : samples)
+    s.mean += v;
+  s.mean /= samples.size();
+  auto rank = [&](double p) {
+    size_t i = (size_t)(p * samples.size() + 0.5);
+    return samples[std::min(std::max(i, (size_t)1), samples.size()) - 1];
+  };
+  s.p50 = rank(0.50);
+  s.p95 = rank(0.95);
+  s.p99 = rank(0.99);
+  return s;
+}
+
+void WriteSummary(FILE *f, const char *name, const Summary &s, bool last) {
+  std::fprintf(f,
+               "  \"%s\": {\"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, "
+               "\"p99\": %.4f}%s\n",
+               name, s.mean, s.p50, s.p95, s.p99, last ? "" : ",");
+}
+
+double Milliseconds(std::chrono::steady_clock::duration d) {
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+} // namespace
+
+FrameBench::FrameBench(int warmupFrames, int measuredFrames, double timeStep)
+    : warmupFrames(warmupFrames), measuredFrames(measuredFrames),
+      timeStep(timeStep) {
+  glGenQueries(QUERY_LATENCY, queries);
+  cpuMs.reserve(measuredFrames);
+  gpuMs.assign(measuredFrames, 0.0);
+  frameMs.reserve(measuredFrames);
+}
+
+FrameBench::~FrameBench() { glDeleteQueries(QUERY_LATENCY, queries); }
+
+void FrameBench::BeginFrame() {
+  auto now = std::chrono::steady_clock::now();
+  if (haveLastFrame && frame > warmupFrames)
+    frameMs.push_back(Milliseconds(now - lastFrameStart));
+  lastFrameStart = now;
+  haveLastFrame = true;
+
+  // the query slot is reused every QUERY_LATENCY frames; read it first
+  if (frame >= QUERY_LATENCY)
+    CollectGpuTime(frame - QUERY_LATENCY);
+  glBeginQuery(GL_TIME_ELAPSED, queries[frame % QUERY_LATENCY]);
+  cpuStart = now;
+}
+
+void FrameBench::EndFrame() {
+  glEndQuery(GL_TIME_ELAPSED);
+  if (frame >= warmupFrames)
+    cpuMs.push_back(
+        Milliseconds(std::chrono::steady_clock::now() - cpuStart));
+  ++frame;
+
+  if (Done()) {
+    // the last frame's interval ends here, and its queries are drained
+    frameMs.push_back(
+        Milliseconds(std::chrono::steady_clock::now() - lastFrameStart));
+    for (int i = std::max(frame - QUERY_LATENCY, 0); i < frame; ++i)
+      CollectGpuTime(i);
+  }
+}
+
+void FrameBench::CollectGpuTime(int frameIndex) {
+  GLuint64 elapsed = 0;
+  glGetQueryObjectui64v(queries[frameIndex % QUERY_LATENCY], GL_QUERY_RESULT,
+                        &elapsed);
+  if (frameIndex >= warmupFrames)
+    gpuMs[frameIndex - warmupFrames] = elapsed / 1.0e6;
+}
+
+bool FrameBench::WriteReport(const std::string &path,
+                             const std::string &app) {
+  FILE *f = std::fopen(path.c_str(), "w");
+  if (!f) {
+    std::fprintf(stderr, "[BENCH] cannot write %s\n", path.c_str());
+    return false;
+  }
+
+  bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+  if (csv) {
+    std::fprintf(f, "frame,cpu_ms,gpu_ms,frame_ms\n");
+    for (size_t i = 0; i < cpuMs.size(); ++i)
+      std::fprintf(f, "%zu,%.4f,%.4f,%.4f\n", i, cpuMs[i], gpuMs[i],
+                   i < frameMs.size() ? frameMs[i] : 0.0);
+  } else {
+    Summary frames = Summarize(frameMs);
+    std::fprintf(f, "{\n");
+    std::fprintf(f, "  \"app\": \"%s\",\n", app.c_str());
+    std::fprintf(f, "  \"warmup_frames\": %d,\n", warmupFrames);
+    std::fprintf(f, "  \"frames\": %zu,\n", cpuMs.size());
+    std::fprintf(f, "  \"time_step\": %.6f,\n", timeStep);
+    std::fprintf(f, "  \"fps\": %.2f,\n",
+                 frames.mean > 0.0 ? 1000.0 / frames.mean : 0.0);
+    WriteSummary(f, "cpu_ms", Summarize(cpuMs), false);
+    WriteSummary(f, "gpu_ms", Summarize(gpuMs), false);
+    WriteSummary(f, "frame_ms", frames, true);
+    std::fprintf(f, "}\n");
+  }
+  std::fclose(f);
+  return true;
+}
@@ -0,0 +1,55 @@
+#ifndef FRAME_BENCH_H
+#define FRAME_BENCH_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Benchmark driver for the render loop. It replaces wall-clock time with a
+// fixed simulated step, so every run renders the same frames. After the
+// warmup it records each frame's CPU time, GPU time and total frame time.
+//
+// GPU time comes from GL_TIME_ELAPSED queries. Results are read
+// QUERY_LATENCY frames later, so the query does not stall the pipeline.
+class FrameBench {
+public:
+  FrameBench(int warmupFrames, int measuredFrames,
+             double timeStep = 1.0 / 60.0);
+  ~FrameBench();
+
+  FrameBench(const FrameBench &) = delete;
+  FrameBench &operator=(const FrameBench &) = delete;
+
+  // Simulated seconds at the current frame.
+  double Time() const { return frame * timeStep; }
+  double TimeStep() const { return timeStep; }
+  bool Done() const { return frame >= warmupFrames + measuredFrames; }
+
+  // Bracket the frame's rendering; EndFrame goes before the buffer swap.
+  void BeginFrame();
+  void EndFrame();
+
+  // Writes per-frame samples as CSV if path ends in ".csv", otherwise a
+  // JSON summary with mean and p50/p95/p99 of each series. Returns false
+  // if the file cannot be written.
+  bool WriteReport(const std::string &path, const std::string &app);
+
+private:
+  static const int QUERY_LATENCY = 3;
+
+  int warmupFrames, measuredFrames;
+  double timeStep;
+  int frame = 0;
+
+  unsigned int queries[QUERY_LATENCY];
+  std::chrono::steady_clock::time_point cpuStart, lastFrameStart;
+  bool haveLastFrame = false;
+
+  // indexed by measured frame; gpuMs is filled in late
+  std::vector<double> cpuMs, gpuMs, frameMs;
+
+  // Reads the query issued for frameIndex, blocking if it is not ready.
+  void CollectGpuTime(int frameIndex);
+};
+
+#endif
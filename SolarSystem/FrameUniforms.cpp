@@ -0,0 +1,16 @@
+#include "FrameUniforms.h"
+#include "GLStateCache.h"
+#include "glad/glad.h"
+
+FrameUniforms::FrameUniforms() {
+  glGenBuffers(1, &UBO);
+  GLStateCache &state = GLStateCache::Instance();
+  state.BindBuffer(GL_UNIFORM_BUFFER, UBO);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr, GL_DYNAMIC_DRAW);
+  state.BindBufferBase(GL_UNIFORM_BUFFER, BINDING, UBO);
+}
+
+void FrameUniforms::Update(const FrameData &data) {
+  GLStateCache::Instance().BindBuffer(GL_UNIFORM_BUFFER, UBO);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data);
+}
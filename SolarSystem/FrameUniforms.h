@@ -0,0 +1,27 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <glm/glm.hpp>
+
+// CPU mirror of the std140 FrameUniforms block declared in the shaders.
+// vec3 values are stored as vec4 because std140 pads them to 16 bytes.
+struct FrameData {
+  glm::mat4 view;
+  glm::mat4 projection;
+  glm::vec4 viewPos;
+  glm::vec4 lightPos;
+  glm::vec4 lightColor;
+};
+
+// Uniform buffer holding per-frame camera and light data. It stays bound to
+// BINDING, so every program that binds its FrameUniforms block there sees
+// the same data after a single Update per frame.
+class FrameUniforms {
+public:
+  static const unsigned int BINDING = 0;
+  unsigned int UBO;
+
+  FrameUniforms();
+  void Update(const FrameData &data);
+};
+#endif
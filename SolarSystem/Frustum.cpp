@@ -0,0 +1,53 @@
+#include "Frustum.h"
+
+Frustum Frustum::FromMatrix(const glm::mat4 &m) {
+  // rows of the matrix; glm is column-major, so row i is (m[0][i], ...)
+  glm::vec4 row[4];
+  for (int i = 0; i < 4; ++i)
+    row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+
+  Frustum f;
+  f.planes[0] = row[3] + row[0]; // left
+  f.planes[1] = row[3] - row[0]; // right
+  f.planes[2] = row[3] + row[1]; // bottom
+  f.planes[3] = row[3] - row[1]; // top
+  f.planes[4] = row[3] + row[2]; // near
+  f.planes[5] = row[3] - row[2]; // far
+
+  // unit normals make the plane distance comparable to a sphere radius
+  for (glm::vec4 &p : f.planes)
+    p = p / glm::length(glm::vec3(p));
+  return f;
+}
+
+size_t CullSpheres(const Frustum &frustum, const glm::vec3 *centers,
+                   const float *radii, size_t count, unsigned char *visible) {
+  const size_t BATCH = 8;
+  size_t visibleCount = 0;
+
+  for (size_t base = 0; base < count; base += BATCH) {
+    size_t n = count - base < BATCH ? count - base : BATCH;
+
+    // transpose the batch so the plane loops below run over flat arrays
+    float x[BATCH] = {}, y[BATCH] = {}, z[BATCH] = {}, r[BATCH] = {};
+    for (size_t k = 0; k < n; ++k) {
+      x[k] = centers[base + k].x;
+      y[k] = centers[base + k].y;
+      z[k] = centers[base + k].z;
+      r[k] = radii[base + k];
+    }
+
+    unsigned char inside[BATCH];
+    for (size_t k = 0; k < BATCH; ++k)
+      inside[k] = 1;
+    for (const glm::vec4 &p : frustum.planes)
+      for (size_t k = 0; k < BATCH; ++k)
+        inside[k] &= (p.x * x[k] + p.y * y[k] + p.z * z[k] + p.w >= -r[k]);
+
+    for (size_t k = 0; k < n; ++k) {
+      visible[base + k] = inside[k];
+      visibleCount += inside[k];
+    }
+  }
+  return visibleCount;
+}
@@ -0,0 +1,29 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// View frustum as six planes (xyz = inward unit normal, w = distance),
+// extracted from a projection * view matrix (Gribb/Hartmann).
+struct Frustum {
+  glm::vec4 planes[6];
+
+  static Frustum FromMatrix(const glm::mat4 &viewProjection);
+
+  // False only if the sphere is fully outside one of the planes.
+  bool IntersectsSphere(const glm::vec3 &center, float radius) const {
+    for (const glm::vec4 &p : planes)
+      if (glm::dot(glm::vec3(p), center) + p.w < -radius)
+        return false;
+    return true;
+  }
+};
+
+// Tests bounding spheres against the frustum in batches of eight, writing
+// visible[i] = 1 when sphere i may be on screen and 0 when it is fully
+// outside a plane. Returns the number of visible spheres.
+size_t CullSpheres(const Frustum &frustum, const glm::vec3 *centers,
+                   const float *radii, size_t count, unsigned char *visible);
+
+#endif
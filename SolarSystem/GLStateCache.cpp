@@ -0,0 +1,132 @@
+#include "GLStateCache.h"
+#include "glad/glad.h"
+#include <iterator>
+
+namespace {
+
+// Cached value meaning "unknown"; no GL object has this name.
+const unsigned int UNKNOWN = 0xFFFFFFFFu;
+
+} // namespace
+
+GLStateCache &GLStateCache::Instance() {
+  static GLStateCache cache;
+  return cache;
+}
+
+GLStateCache::GLStateCache() { Invalidate(); }
+
+void GLStateCache::Invalidate() {
+  program = UNKNOWN;
+  vao = UNKNOWN;
+  activeUnit = -1;
+  for (int i = 0; i < MAX_TEXTURE_UNITS; ++i) {
+    textureTargets[i] = UNKNOWN;
+    textures[i] = UNKNOWN;
+  }
+  buffers.clear();
+  vaoElementBuffers.clear();
+  capabilities.clear();
+}
+
+bool GLStateCache::Changed(bool changed) {
+  if (changed)
+    ++frame.issued;
+  else
+    ++frame.elided;
+  return changed;
+}
+
+void GLStateCache::UseProgram(unsigned int id) {
+  if (Changed(program != id)) {
+    glUseProgram(id);
+    program = id;
+  }
+}
+
+void GLStateCache::BindVertexArray(unsigned int id) {
+  if (!Changed(vao != id))
+    return;
+  glBindVertexArray(id);
+  vao = id;
+  auto it = vaoElementBuffers.find(id);
+  buffers[GL_ELEMENT_ARRAY_BUFFER] =
+      it != vaoElementBuffers.end() ? it->second : UNKNOWN;
+}
+
+void GLStateCache::BindBuffer(unsigned int target, unsigned int buffer) {
+  auto it = buffers.find(target);
+  if (!Changed(it == buffers.end() || it->second != buffer))
+    return;
+  glBindBuffer(target, buffer);
+  buffers[target] = buffer;
+  if (target == GL_ELEMENT_ARRAY_BUFFER && vao != UNKNOWN)
+    vaoElementBuffers[vao] = buffer;
+}
+
+void GLStateCache::BindBufferBase(unsigned int target, unsigned int index,
+                                  unsigned int buffer) {
+  // indexed bindings are not cached, only the generic one they overwrite
+  Changed(true);
+  glBindBufferBase(target, index, buffer);
+  buffers[target] = buffer;
+}
+
+void GLStateCache::BindTexture(int unit, unsigned int target,
+                               unsigned int texture) {
+  if (!Changed(textureTargets[unit] != target || textures[unit] != texture))
+    return;
+  if (activeUnit != unit) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    activeUnit = unit;
+  }
+  glBindTexture(target, texture);
+  textureTargets[unit] = target;
+  textures[unit] = texture;
+}
+
+void GLStateCache::SetCapability(unsigned int cap, bool enabled) {
+  auto it = capabilities.find(cap);
+  if (!Changed(it == capabilities.end() || it->second != enabled))
+    return;
+  if (enabled)
+    glEnable(cap);
+  else
+    glDisable(cap);
+  capabilities[cap] = enabled;
+}
+
+void GLStateCache::Enable(unsigned int cap) { SetCapability(cap, true); }
+
+void GLStateCache::Disable(unsigned int cap) { SetCapability(cap, false); }
+
+void GLStateCache::DeleteBuffer(unsigned int buffer) {
+  glDeleteBuffers(1, &buffer);
+  for (auto &binding : buffers)
+    if (binding.second == buffer)
+      binding.second = 0;
+  // only the bound VAO loses its attachment; forget it for the others
+  for (auto it = vaoElementBuffers.begin(); it != vaoElementBuffers.end();)
+    it = it->second == buffer ? vaoElementBuffers.erase(it) : std::next(it);
+}
+
+void GLStateCache::DeleteVertexArray(unsigned int id) {
+  glDeleteVertexArrays(1, &id);
+  vaoElementBuffers.erase(id);
+  if (vao == id) {
+    vao = 0;
+    buffers[GL_ELEMENT_ARRAY_BUFFER] = UNKNOWN;
+  }
+}
+
+void GLStateCache::DeleteTexture(unsigned int texture) {
+  glDeleteTextures(1, &texture);
+  for (int i = 0; i < MAX_TEXTURE_UNITS; ++i)
+    if (textures[i] == texture)
+      textures[i] = 0;
+}
+
+void GLStateCache::BeginFrame() {
+  lastFrame = frame;
+  frame = GLStateStats();
+}
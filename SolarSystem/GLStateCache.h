@@ -0,0 +1,70 @@
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include <unordered_map>
+
+// Calls issued to and skipped by the cache during one frame.
+struct GLStateStats {
+  unsigned int issued = 0;
+  unsigned int elided = 0;
+};
+
+// Shadow copy of the GL binding state of the current context. Each setter
+// compares against the cached value and only calls GL when it changes.
+//
+// The cache is only correct if every bind, enable and delete of the
+// tracked objects goes through it; Invalidate() forgets everything after
+// code that bypasses it. Element array bindings are remembered per VAO,
+// since they are part of the vertex array state.
+class GLStateCache {
+public:
+  static const int MAX_TEXTURE_UNITS = 16;
+
+  // The cache for the one GL context the application renders with.
+  static GLStateCache &Instance();
+
+  void UseProgram(unsigned int program);
+  void BindVertexArray(unsigned int vao);
+  void BindBuffer(unsigned int target, unsigned int buffer);
+  // glBindBufferBase also replaces the generic binding of target.
+  void BindBufferBase(unsigned int target, unsigned int index,
+                      unsigned int buffer);
+  // Selects unit with glActiveTexture only if needed.
+  void BindTexture(int unit, unsigned int target, unsigned int texture);
+  void Enable(unsigned int cap);
+  void Disable(unsigned int cap);
+
+  // Delete the objects and drop them from the cache, as GL unbinds
+  // deleted names from the current context.
+  void DeleteBuffer(unsigned int buffer);
+  void DeleteVertexArray(unsigned int vao);
+  void DeleteTexture(unsigned int texture);
+
+  void Invalidate();
+
+  // Ends the current frame's counters; LastFrame() then reports them.
+  void BeginFrame();
+  const GLStateStats &LastFrame() const { return lastFrame; }
+
+private:
+  GLStateCache();
+
+  unsigned int program;
+  unsigned int vao;
+  int activeUnit;
+  // (target, texture) per unit; binding another target on a unit simply
+  // counts as a change
+  unsigned int textureTargets[MAX_TEXTURE_UNITS];
+  unsigned int textures[MAX_TEXTURE_UNITS];
+  std::unordered_map<unsigned int, unsigned int> buffers;
+  std::unordered_map<unsigned int, unsigned int> vaoElementBuffers;
+  std::unordered_map<unsigned int, bool> capabilities;
+
+  GLStateStats frame, lastFrame;
+
+  // true if the call must be issued; counts it either way
+  bool Changed(bool changed);
+  void SetCapability(unsigned int cap, bool enabled);
+};
+
+#endif
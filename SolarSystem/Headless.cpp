@@ -0,0 +1,181 @@
+#include "Headless.h"
+#include "glad/glad.h"
+#include <chrono>
+#include <cstdio>
+
+#ifdef HEADLESS_OSMESA
+#include <GL/osmesa.h>
+#else
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+namespace {
+
+long long NowTicks() {
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+} // namespace
+
+#ifdef HEADLESS_OSMESA
+
+bool HeadlessContext::Create(int w, int h) {
+  const int attribs[] = {OSMESA_FORMAT,
+                         OSMESA_RGBA,
+                         OSMESA_DEPTH_BITS,
+                         24,
+                         OSMESA_PROFILE,
+                         OSMESA_CORE_PROFILE,
+                         OSMESA_CONTEXT_MAJOR_VERSION,
+                         3,
+                         OSMESA_CONTEXT_MINOR_VERSION,
+                         3,
+                         0};
+  OSMesaContext ctx = OSMesaCreateContextAttribs(attribs, nullptr);
+  if (!ctx) {
+    std::fprintf(stderr, "[HEADLESS] OSMesa context creation failed\n");
+    return false;
+  }
+  // OSMesa needs a client-side buffer to make the context current even
+  // though everything is drawn into the FBO
+  osmesaBuffer = new unsigned char[(size_t)w * h * 4];
+  if (!OSMesaMakeCurrent(ctx, osmesaBuffer, GL_UNSIGNED_BYTE, w, h)) {
+    std::fprintf(stderr, "[HEADLESS] OSMesaMakeCurrent failed\n");
+    OSMesaDestroyContext(ctx);
+    delete[] osmesaBuffer;
+    osmesaBuffer = nullptr;
+    return false;
+  }
+  context = ctx;
+  width = w;
+  height = h;
+  startTicks = NowTicks();
+  return true;
+}
+
+void *HeadlessContext::GetProcAddress(const char *name) {
+  return (void *)OSMesaGetProcAddress(name);
+}
+
+#else
+
+bool HeadlessContext::Create(int w, int h) {
+  // the surfaceless platform needs neither a display server nor a GPU;
+  // with no GPU Mesa falls back to llvmpipe
+  auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+      eglGetProcAddress("eglGetPlatformDisplayEXT");
+  EGLDisplay dpy =
+      getPlatformDisplay
+          ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                               EGL_DEFAULT_DISPLAY, nullptr)
+          : EGL_NO_DISPLAY;
+  if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, nullptr, nullptr)) {
+    std::fprintf(stderr, "[HEADLESS] no surfaceless EGL display\n");
+    return false;
+  }
+
+  // the default EGL_SURFACE_TYPE asks for window support, which the
+  // surfaceless platform has none of
+  const EGLint configAttribs[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                                  EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                                  EGL_NONE};
+  EGLConfig config;
+  EGLint configCount = 0;
+  eglChooseConfig(dpy, configAttribs, &config, 1, &configCount);
+  const EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                   3,
+                                   EGL_CONTEXT_MINOR_VERSION,
+                                   3,
+                                   EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                   EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                   EGL_NONE};
+  EGLContext ctx = EGL_NO_CONTEXT;
+  if (configCount > 0 && eglBindAPI(EGL_OPENGL_API))
+    ctx = eglCreateContext(dpy, config, EGL_NO_CONTEXT, contextAttribs);
+  if (ctx == EGL_NO_CONTEXT ||
+      !eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx)) {
+    std::fprintf(stderr, "[HEADLESS] EGL context creation failed: 0x%x\n",
+                 eglGetError());
+    if (ctx != EGL_NO_CONTEXT)
+      eglDestroyContext(dpy, ctx);
+    eglTerminate(dpy);
+    return false;
+  }
+  display = dpy;
+  context = ctx;
+  width = w;
+  height = h;
+  startTicks = NowTicks();
+  return true;
+}
+
+void *HeadlessContext::GetProcAddress(const char *name) {
+  return (void *)eglGetProcAddress(name);
+}
+
+#endif
+
+void HeadlessContext::CreateFramebuffer() {
+  glGenRenderbuffers(1, &colorBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glGenRenderbuffers(1, &depthBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, colorBuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                            GL_RENDERBUFFER, depthBuffer);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    std::fprintf(stderr, "[HEADLESS] framebuffer incomplete\n");
+  glViewport(0, 0, width, height);
+}
+
+void HeadlessContext::EndFrame() {
+  // wait for the frame that last used this slot, as a swap would
+  GLsync fence = (GLsync)frameFences[frameIndex];
+  if (fence) {
+    glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+    glDeleteSync(fence);
+  }
+  frameFences[frameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  glFlush();
+  frameIndex = (frameIndex + 1) % MAX_FRAMES_IN_FLIGHT;
+}
+
+double HeadlessContext::GetTime() const {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::duration(NowTicks() - startTicks))
+      .count();
+}
+
+void HeadlessContext::Destroy() {
+  if (!context)
+    return;
+  for (void *&fence : frameFences) {
+    if (fence)
+      glDeleteSync((GLsync)fence);
+    fence = nullptr;
+  }
+  if (framebuffer) {
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    framebuffer = colorBuffer = depthBuffer = 0;
+  }
+#ifdef HEADLESS_OSMESA
+  OSMesaDestroyContext((OSMesaContext)context);
+  delete[] osmesaBuffer;
+  osmesaBuffer = nullptr;
+#else
+  eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  eglDestroyContext(display, context);
+  eglTerminate(display);
+  display = nullptr;
+#endif
+  context = nullptr;
+}
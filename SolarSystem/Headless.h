@@ -0,0 +1,50 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+// GL context without a window or display, for build machines with neither.
+// By default it uses EGL on Mesa's surfaceless platform; building with
+// HEADLESS_OSMESA switches to OSMesa instead. Either way frames are
+// rendered into a framebuffer object of the requested size.
+class HeadlessContext {
+public:
+  HeadlessContext() = default;
+  ~HeadlessContext() { Destroy(); }
+
+  HeadlessContext(const HeadlessContext &) = delete;
+  HeadlessContext &operator=(const HeadlessContext &) = delete;
+
+  // Creates a GL 3.3 core context and makes it current. Returns false and
+  // prints the reason if no headless context is available.
+  bool Create(int width, int height);
+  // Creates the FBO and leaves it bound; call once GL is loaded.
+  void CreateFramebuffer();
+  void Destroy();
+
+  // GL entry point lookup for the function loader.
+  static void *GetProcAddress(const char *name);
+
+  // Stands in for a buffer swap: flushes the frame and keeps at most
+  // MAX_FRAMES_IN_FLIGHT frames queued, so the CPU cannot run arbitrarily
+  // far ahead of the GPU.
+  void EndFrame();
+
+  // Seconds since Create, standing in for glfwGetTime.
+  double GetTime() const;
+
+  int Width() const { return width; }
+  int Height() const { return height; }
+
+private:
+  static const int MAX_FRAMES_IN_FLIGHT = 2;
+
+  int width = 0, height = 0;
+  void *display = nullptr, *context = nullptr;
+  // OSMesa renders into client memory behind the FBO
+  unsigned char *osmesaBuffer = nullptr;
+  unsigned int framebuffer = 0, colorBuffer = 0, depthBuffer = 0;
+  void *frameFences[MAX_FRAMES_IN_FLIGHT] = {};
+  int frameIndex = 0;
+  long long startTicks = 0;
+};
+
+#endif
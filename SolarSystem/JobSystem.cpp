@@ -0,0 +1,99 @@
+#include "JobSystem.h"
+
+unsigned int JobSystem::DefaultWorkerCount() {
+  unsigned int cores = std::thread::hardware_concurrency();
+  return cores > 1 ? cores - 1 : 0;
+}
+
+JobSystem::JobSystem(unsigned int workerCount) {
+  for (unsigned int i = 0; i <= workerCount; ++i)
+    queues.push_back(std::make_unique<Queue>());
+  for (unsigned int i = 1; i <= workerCount; ++i)
+    workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    quit = true;
+  }
+  wake.notify_all();
+  for (auto &worker : workers)
+    worker.join();
+}
+
+void JobSystem::ParallelFor(size_t count, size_t chunkSize,
+                            const std::function<void(size_t, size_t)> &fn) {
+  if (count == 0)
+    return;
+  if (chunkSize == 0)
+    chunkSize = 1;
+  // a single chunk is not worth waking anyone for
+  if (workers.empty() || count <= chunkSize) {
+    fn(0, count);
+    return;
+  }
+
+  size_t chunks = (count + chunkSize - 1) / chunkSize;
+  std::atomic<size_t> pending(chunks);
+  // counted before the push so a fast thief can never take it below zero
+  queuedJobs.fetch_add(chunks);
+
+  // deal chunks round-robin so every deque starts with a contiguous share
+  for (size_t c = 0; c < chunks; ++c) {
+    size_t begin = c * chunkSize;
+    size_t end = begin + chunkSize < count ? begin + chunkSize : count;
+    Queue &queue = *queues[c * queues.size() / chunks];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.jobs.push_back({&fn, begin, end, &pending});
+  }
+  {
+    std::lock_guard<std::mutex> lock(wakeMutex);
+  }
+  wake.notify_all();
+
+  while (pending.load(std::memory_order_acquire) > 0)
+    if (!RunOneJob(0))
+      std::this_thread::yield();
+}
+
+bool JobSystem::RunOneJob(size_t self) {
+  Job job;
+  bool found = false;
+  {
+    Queue &own = *queues[self];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.jobs.empty()) {
+      job = own.jobs.back();
+      own.jobs.pop_back();
+      found = true;
+    }
+  }
+  for (size_t i = 1; !found && i < queues.size(); ++i) {
+    Queue &victim = *queues[(self + i) % queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.jobs.empty()) {
+      job = victim.jobs.front();
+      victim.jobs.pop_front();
+      found = true;
+    }
+  }
+  if (!found)
+    return false;
+
+  queuedJobs.fetch_sub(1);
+  (*job.fn)(job.begin, job.end);
+  job.pending->fetch_sub(1, std::memory_order_release);
+  return true;
+}
+
+void JobSystem::WorkerLoop(size_t self) {
+  for (;;) {
+    if (RunOneJob(self))
+      continue;
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    wake.wait(lock, [this] { return quit || queuedJobs.load() > 0; });
+    if (quit)
+      return;
+  }
+}
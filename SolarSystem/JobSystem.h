@@ -0,0 +1,63 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of worker threads with one job deque per thread. Owners pop
+// from the back of their own deque and idle threads steal from the front of
+// the others, so chunks stay cache-warm but load still balances.
+//
+// ParallelFor splits a range into fixed-size chunks, so which chunk covers
+// which elements never depends on the number of threads. Calls must not be
+// nested inside a running job.
+class JobSystem {
+public:
+  // workerCount excludes the calling thread, which also runs jobs.
+  explicit JobSystem(unsigned int workerCount = DefaultWorkerCount());
+  ~JobSystem();
+
+  JobSystem(const JobSystem &) = delete;
+  JobSystem &operator=(const JobSystem &) = delete;
+
+  // Runs fn(begin, end) over [0, count) in chunks of chunkSize and blocks
+  // until every chunk has finished.
+  void ParallelFor(size_t count, size_t chunkSize,
+                   const std::function<void(size_t, size_t)> &fn);
+
+  // Worker threads plus the calling thread.
+  unsigned int ThreadCount() const { return (unsigned int)queues.size(); }
+
+  static unsigned int DefaultWorkerCount();
+
+private:
+  struct Job {
+    const std::function<void(size_t, size_t)> *fn;
+    size_t begin, end;
+    std::atomic<size_t> *pending;
+  };
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+  };
+
+  // queues[0] belongs to the thread calling ParallelFor
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+  std::mutex wakeMutex;
+  std::condition_variable wake;
+  std::atomic<size_t> queuedJobs{0};
+  bool quit = false;
+
+  void WorkerLoop(size_t self);
+  bool RunOneJob(size_t self);
+};
+
+#endif
@@ -0,0 +1,200 @@
+#include "OrbitKernel.h"
+#include <cmath>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ORBIT_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Cody-Waite split of pi/2 so that x - j * pi/2 stays exact in float.
+const float TWO_OVER_PI = 0.636619772367581343f;
+const float PIO2_1 = 1.5703125f;
+const float PIO2_2 = 4.837512969970703125e-4f;
+const float PIO2_3 = 7.54978995489188216e-8f;
+
+// Minimax coefficients for sin/cos on [-pi/4, pi/4] (Cephes sinf/cosf).
+const float S1 = -1.6666654611e-1f;
+const float S2 = 8.3321608736e-3f;
+const float S3 = -1.9515295891e-4f;
+const float C1 = 4.166664568298827e-2f;
+const float C2 = -1.388731625493765e-3f;
+const float C3 = 2.443315711809948e-5f;
+
+void UpdateOrbitsScalar(BodyStore &bodies, float time, size_t begin,
+                        size_t end) {
+  const float *radius = bodies.orbitRadius.data();
+  const float *speed = bodies.orbitSpeed.data();
+  glm::vec3 *position = bodies.position.data();
+
+  for (size_t i = begin; i < end; ++i) {
+    float s, c;
+    OrbitSinCos(speed[i] * time, s, c);
+    position[i] = glm::vec3(radius[i] * c, 0.0f, radius[i] * s);
+  }
+}
+
+#ifdef ORBIT_KERNEL_X86
+
+__attribute__((target("sse2"))) inline void SinCos4(__m128 x, __m128 &s,
+                                                    __m128 &c) {
+  __m128i j = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(TWO_OVER_PI)));
+  __m128 y = _mm_cvtepi32_ps(j);
+  __m128 r = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(PIO2_1)));
+  r = _mm_sub_ps(r, _mm_mul_ps(y, _mm_set1_ps(PIO2_2)));
+  r = _mm_sub_ps(r, _mm_mul_ps(y, _mm_set1_ps(PIO2_3)));
+
+  __m128 z = _mm_mul_ps(r, r);
+  __m128 ps = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(S3), z), _mm_set1_ps(S2));
+  ps = _mm_add_ps(_mm_mul_ps(ps, z), _mm_set1_ps(S1));
+  ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, z), r), r);
+  __m128 pc = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(C3), z), _mm_set1_ps(C2));
+  pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(C1));
+  pc = _mm_mul_ps(_mm_mul_ps(pc, z), z);
+  pc = _mm_add_ps(_mm_sub_ps(pc, _mm_mul_ps(z, _mm_set1_ps(0.5f))),
+                  _mm_set1_ps(1.0f));
+
+  // odd quadrants swap sin and cos; the sign follows the quadrant
+  __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(
+      _mm_and_si128(j, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+  __m128 sinSign = _mm_castsi128_ps(
+      _mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), 30));
+  __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(
+      _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(2)),
+      30));
+  s = _mm_or_ps(_mm_and_ps(swap, pc), _mm_andnot_ps(swap, ps));
+  c = _mm_or_ps(_mm_and_ps(swap, ps), _mm_andnot_ps(swap, pc));
+  s = _mm_xor_ps(s, sinSign);
+  c = _mm_xor_ps(c, cosSign);
+}
+
+__attribute__((target("sse2"))) void
+UpdateOrbitsSSE2(BodyStore &bodies, float time, size_t begin, size_t end) {
+  const float *radius = bodies.orbitRadius.data();
+  const float *speed = bodies.orbitSpeed.data();
+  glm::vec3 *position = bodies.position.data();
+  const __m128 t = _mm_set1_ps(time);
+  alignas(16) float x[8], z[8];
+
+  size_t i = begin;
+  for (; i + 8 <= end; i += 8) {
+    for (int k = 0; k < 8; k += 4) {
+      __m128 s, c;
+      SinCos4(_mm_mul_ps(_mm_loadu_ps(speed + i + k), t), s, c);
+      __m128 r = _mm_loadu_ps(radius + i + k);
+      _mm_store_ps(x + k, _mm_mul_ps(r, c));
+      _mm_store_ps(z + k, _mm_mul_ps(r, s));
+    }
+    for (int k = 0; k < 8; ++k)
+      position[i + k] = glm::vec3(x[k], 0.0f, z[k]);
+  }
+  UpdateOrbitsScalar(bodies, time, i, end);
+}
+
+__attribute__((target("avx2"))) inline void SinCos8(__m256 x, __m256 &s,
+                                                    __m256 &c) {
+  __m256i j = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(TWO_OVER_PI)));
+  __m256 y = _mm256_cvtepi32_ps(j);
+  __m256 r = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(PIO2_1)));
+  r = _mm256_sub_ps(r, _mm256_mul_ps(y, _mm256_set1_ps(PIO2_2)));
+  r = _mm256_sub_ps(r, _mm256_mul_ps(y, _mm256_set1_ps(PIO2_3)));
+
+  __m256 z = _mm256_mul_ps(r, r);
+  __m256 ps =
+      _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(S3), z), _mm256_set1_ps(S2));
+  ps = _mm256_add_ps(_mm256_mul_ps(ps, z), _mm256_set1_ps(S1));
+  ps = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(ps, z), r), r);
+  __m256 pc =
+      _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(C3), z), _mm256_set1_ps(C2));
+  pc = _mm256_add_ps(_mm256_mul_ps(pc, z), _mm256_set1_ps(C1));
+  pc = _mm256_mul_ps(_mm256_mul_ps(pc, z), z);
+  pc = _mm256_add_ps(_mm256_sub_ps(pc, _mm256_mul_ps(z, _mm256_set1_ps(0.5f))),
+                     _mm256_set1_ps(1.0f));
+
+  __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+      _mm256_and_si256(j, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+  __m256 sinSign = _mm256_castsi256_ps(
+      _mm256_slli_epi32(_mm256_and_si256(j, _mm256_set1_epi32(2)), 30));
+  __m256 cosSign = _mm256_castsi256_ps(_mm256_slli_epi32(
+      _mm256_and_si256(_mm256_add_epi32(j, _mm256_set1_epi32(1)),
+                       _mm256_set1_epi32(2)),
+      30));
+  s = _mm256_xor_ps(_mm256_blendv_ps(ps, pc, swap), sinSign);
+  c = _mm256_xor_ps(_mm256_blendv_ps(pc, ps, swap), cosSign);
+}
+
+__attribute__((target("avx2"))) void
+UpdateOrbitsAVX2(BodyStore &bodies, float time, size_t begin, size_t end) {
+  const float *radius = bodies.orbitRadius.data();
+  const float *speed = bodies.orbitSpeed.data();
+  glm::vec3 *position = bodies.position.data();
+  const __m256 t = _mm256_set1_ps(time);
+  alignas(32) float x[16], z[16];
+
+  size_t i = begin;
+  for (; i + 16 <= end; i += 16) {
+    for (int k = 0; k < 16; k += 8) {
+      __m256 s, c;
+      SinCos8(_mm256_mul_ps(_mm256_loadu_ps(speed + i + k), t), s, c);
+      __m256 r = _mm256_loadu_ps(radius + i + k);
+      _mm256_store_ps(x + k, _mm256_mul_ps(r, c));
+      _mm256_store_ps(z + k, _mm256_mul_ps(r, s));
+    }
+    for (int k = 0; k < 16; ++k)
+      position[i + k] = glm::vec3(x[k], 0.0f, z[k]);
+  }
+  UpdateOrbitsScalar(bodies, time, i, end);
+}
+
+#endif
+
+typedef void (*OrbitKernelFn)(BodyStore &, float, size_t, size_t);
+
+struct OrbitKernel {
+  OrbitKernelFn fn;
+  const char *name;
+};
+
+OrbitKernel SelectKernel() {
+#ifdef ORBIT_KERNEL_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return {UpdateOrbitsAVX2, "avx2"};
+  if (__builtin_cpu_supports("sse2"))
+    return {UpdateOrbitsSSE2, "sse2"};
+#endif
+  return {UpdateOrbitsScalar, "scalar"};
+}
+
+const OrbitKernel &Kernel() {
+  static const OrbitKernel kernel = SelectKernel();
+  return kernel;
+}
+
+} // namespace
+
+void OrbitSinCos(float x, float &s, float &c) {
+  int32_t j = (int32_t)std::nearbyint(x * TWO_OVER_PI);
+  float y = (float)j;
+  float r = ((x - y * PIO2_1) - y * PIO2_2) - y * PIO2_3;
+
+  float z = r * r;
+  float ps = ((S3 * z + S2) * z + S1) * z * r + r;
+  float pc = ((C3 * z + C2) * z + C1) * z * z - z * 0.5f + 1.0f;
+
+  if (j & 1) {
+    float tmp = ps;
+    ps = pc;
+    pc = tmp;
+  }
+  s = (j & 2) ? -ps : ps;
+  c = ((j + 1) & 2) ? -pc : pc;
+}
+
+void UpdateOrbits(BodyStore &bodies, float time, size_t begin, size_t end) {
+  Kernel().fn(bodies, time, begin, end);
+}
+
+const char *OrbitKernelName() { return Kernel().name; }
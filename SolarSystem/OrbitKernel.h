@@ -0,0 +1,19 @@
+#ifndef ORBIT_KERNEL_H
+#define ORBIT_KERNEL_H
+
+#include "BodyStore.h"
+
+// Writes position[i] = (r cos(wt), 0, r sin(wt)) for every body in
+// [begin, end). Uses the widest kernel the CPU supports (AVX2, SSE2 or
+// scalar), chosen once on first call; all variants share the same
+// polynomial sincos.
+void UpdateOrbits(BodyStore &bodies, float time, size_t begin, size_t end);
+
+// Name of the kernel UpdateOrbits dispatches to ("avx2", "sse2", "scalar").
+const char *OrbitKernelName();
+
+// Polynomial sincos shared by every kernel variant. Error is below 1e-6 for
+// |x| < 8192 and grows slowly beyond that as range reduction loses bits.
+void OrbitSinCos(float x, float &s, float &c);
+
+#endif
@@ -0,0 +1,167 @@
+#include "Profiler.h"
+#include "glad/glad.h"
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+double Microseconds(std::chrono::steady_clock::duration d) {
+  return std::chrono::duration<double, std::micro>(d).count();
+}
+
+// Writes s as a JSON string literal.
+void WriteJsonString(FILE *f, const char *s) {
+  std::fputc('"', f);
+  for (; *s; ++s) {
+    if (*s == '"' || *s == '\\')
+      std::fputc('\\', f);
+    std::fputc(*s, f);
+  }
+  std::fputc('"', f);
+}
+
+} // namespace
+
+Profiler &Profiler::Instance() {
+  static Profiler profiler;
+  return profiler;
+}
+
+void Profiler::Enable(bool captureTrace) {
+  this->captureTrace = captureTrace;
+  if (enabled)
+    return;
+  enabled = true;
+  GLint64 now = 0;
+  glGetInteger64v(GL_TIMESTAMP, &now);
+  gpuEpoch = now;
+  cpuEpoch = Clock::now();
+  Current().frame = frame;
+}
+
+void Profiler::BeginFrame() {
+  if (!enabled)
+    return;
+  ++frame;
+  FrameSet &set = Current();
+  if (set.frame >= 0) {
+    Collect(set);
+    lastFrame.swap(set.totals);
+  }
+  set.frame = frame;
+  set.totals.clear();
+  set.usedQueries = 0;
+}
+
+ProfileScopeStats &Profiler::Totals(FrameSet &set, const char *name) {
+  for (ProfileScopeStats &stats : set.totals)
+    if (stats.name == name || std::strcmp(stats.name, name) == 0)
+      return stats;
+  set.totals.push_back(ProfileScopeStats());
+  set.totals.back().name = name;
+  return set.totals.back();
+}
+
+unsigned int Profiler::ReserveQueries(FrameSet &set) {
+  if (set.usedQueries + 2 > set.queries.size()) {
+    // grow in blocks so a frame with many scopes settles quickly
+    size_t count = set.queries.empty() ? 32 : set.queries.size();
+    set.queries.resize(set.queries.size() + count);
+    glGenQueries((GLsizei)count, &set.queries[set.queries.size() - count]);
+  }
+  unsigned int first = set.usedQueries;
+  set.usedQueries += 2;
+  return first;
+}
+
+void Profiler::BeginCpu(const char *name) {
+  cpuStack.push_back({name, Clock::now()});
+}
+
+void Profiler::EndCpu() {
+  const OpenScope &scope = cpuStack.back();
+  Clock::time_point end = Clock::now();
+  ProfileScopeStats &stats = Totals(Current(), scope.name);
+  stats.cpuMs += Microseconds(end - scope.start) / 1000.0;
+  ++stats.calls;
+  AddEvent(scope.name, false, Microseconds(scope.start - cpuEpoch),
+           Microseconds(end - scope.start));
+  cpuStack.pop_back();
+}
+
+void Profiler::BeginGpu(const char *name) {
+  FrameSet &set = Current();
+  unsigned int first = ReserveQueries(set);
+  glQueryCounter(set.queries[first], GL_TIMESTAMP);
+  gpuStack.push_back((unsigned int)set.gpuScopes.size());
+  set.gpuScopes.push_back({name, first});
+}
+
+void Profiler::EndGpu() {
+  FrameSet &set = Current();
+  glQueryCounter(set.queries[set.gpuScopes[gpuStack.back()].first + 1],
+                 GL_TIMESTAMP);
+  gpuStack.pop_back();
+}
+
+void Profiler::Collect(FrameSet &set) {
+  for (const GpuScope &scope : set.gpuScopes) {
+    GLuint64 start = 0, end = 0;
+    glGetQueryObjectui64v(set.queries[scope.first], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(set.queries[scope.first + 1], GL_QUERY_RESULT,
+                          &end);
+    double durationUs = (end - start) / 1000.0;
+    Totals(set, scope.name).gpuMs += durationUs / 1000.0;
+    AddEvent(scope.name, true, ((long long)start - gpuEpoch) / 1000.0,
+             durationUs);
+  }
+  set.gpuScopes.clear();
+}
+
+void Profiler::AddEvent(const char *name, bool gpu, double startUs,
+                        double durationUs) {
+  if (captureTrace && trace.size() < MAX_TRACE_EVENTS)
+    trace.push_back({name, gpu, startUs, durationUs});
+}
+
+bool Profiler::WriteTrace(const std::string &path) {
+  // the last two frames' GPU scopes are still pending
+  for (long f = frame - FRAME_SETS + 1; f <= frame; ++f)
+    if (f >= 0 && sets[f % FRAME_SETS].frame == f)
+      Collect(sets[f % FRAME_SETS]);
+
+  FILE *f = std::fopen(path.c_str(), "w");
+  if (!f) {
+    std::fprintf(stderr, "[PROFILER] cannot write %s\n", path.c_str());
+    return false;
+  }
+  // CPU scopes on thread 1, GPU scopes on thread 2
+  std::fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  std::fprintf(f, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+                  "\"tid\": 1, \"args\": {\"name\": \"CPU\"}},\n");
+  std::fprintf(f, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+                  "\"tid\": 2, \"args\": {\"name\": \"GPU\"}}");
+  for (const TraceEvent &event : trace) {
+    std::fprintf(f, ",\n{\"name\": ");
+    WriteJsonString(f, event.name);
+    std::fprintf(f,
+                 ", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, "
+                 "\"dur\": %.3f, \"pid\": 1, \"tid\": %d}",
+                 event.gpu ? "gpu" : "cpu", event.startUs, event.durationUs,
+                 event.gpu ? 2 : 1);
+  }
+  std::fprintf(f, "\n]}\n");
+  std::fclose(f);
+  return true;
+}
+
+void Profiler::Destroy() {
+  for (FrameSet &set : sets) {
+    if (!set.queries.empty())
+      glDeleteQueries((GLsizei)set.queries.size(), set.queries.data());
+    set = FrameSet();
+  }
+  cpuStack.clear();
+  gpuStack.clear();
+  enabled = false;
+}
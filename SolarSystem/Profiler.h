@@ -0,0 +1,158 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Totals of one named scope over a frame.
+struct ProfileScopeStats {
+  const char *name;
+  double cpuMs = 0.0;
+  double gpuMs = 0.0;
+  unsigned int calls = 0;
+};
+
+// Scoped CPU and GPU profiler for the render thread. It does nothing
+// until Enable() is called.
+//
+// CPU scopes read the steady clock. GPU scopes put a GL_TIMESTAMP query
+// at each end of the scope; unlike GL_TIME_ELAPSED, these may nest and
+// can overlap FrameBench's frame query. The queries are double-buffered
+// by frame. BeginFrame collects the set written two frames earlier,
+// which is normally complete by then. So LastFrame() describes that
+// frame.
+//
+// Scope names must be string literals or otherwise outlive the profiler.
+class Profiler {
+public:
+  static Profiler &Instance();
+
+  // Starts profiling; needs a current GL context. With captureTrace,
+  // every scope is also kept for WriteTrace.
+  void Enable(bool captureTrace);
+  bool Enabled() const { return enabled; }
+
+  // Closes the current frame, collects the GPU times of the frame that
+  // last used this frame's query set and publishes its totals. Call it
+  // outside of any scope.
+  void BeginFrame();
+  const std::vector<ProfileScopeStats> &LastFrame() const {
+    return lastFrame;
+  }
+
+  // Writes the captured scopes in the Chrome trace event format, for
+  // chrome://tracing or Perfetto. Returns false if the file cannot be
+  // written.
+  bool WriteTrace(const std::string &path);
+
+  // Releases the queries; the GL context must still be current.
+  void Destroy();
+
+  // used by the scope guards below
+  void BeginCpu(const char *name);
+  void EndCpu();
+  void BeginGpu(const char *name);
+  void EndGpu();
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  // The trace keeps at most this many events, so a long session does not
+  // grow without bound.
+  static const size_t MAX_TRACE_EVENTS = 1 << 20;
+  static const int FRAME_SETS = 2;
+
+  struct OpenScope {
+    const char *name;
+    Clock::time_point start;
+  };
+  struct GpuScope {
+    const char *name;
+    unsigned int first; // start query; the end query follows it
+  };
+  // One frame's CPU totals and GPU queries awaiting their results.
+  struct FrameSet {
+    long frame = -1;
+    std::vector<ProfileScopeStats> totals;
+    std::vector<GpuScope> gpuScopes;
+    std::vector<unsigned int> queries;
+    unsigned int usedQueries = 0;
+  };
+  struct TraceEvent {
+    const char *name;
+    bool gpu;
+    double startUs, durationUs;
+  };
+
+  Profiler() = default;
+
+  bool enabled = false;
+  bool captureTrace = false;
+  long frame = 0;
+  FrameSet sets[FRAME_SETS];
+  std::vector<OpenScope> cpuStack;
+  std::vector<unsigned int> gpuStack;
+  std::vector<ProfileScopeStats> lastFrame;
+  std::vector<TraceEvent> trace;
+
+  // CPU and GPU clock readings taken together, to line up GPU events
+  Clock::time_point cpuEpoch;
+  long long gpuEpoch = 0;
+
+  FrameSet &Current() { return sets[frame % FRAME_SETS]; }
+  ProfileScopeStats &Totals(FrameSet &set, const char *name);
+  // Index of two free queries in set, generating more as needed.
+  unsigned int ReserveQueries(FrameSet &set);
+  void Collect(FrameSet &set);
+  void AddEvent(const char *name, bool gpu, double startUs,
+                double durationUs);
+};
+
+// Times its enclosing scope on the CPU.
+class CpuProfileScope {
+public:
+  explicit CpuProfileScope(const char *name)
+      : active(Profiler::Instance().Enabled()) {
+    if (active)
+      Profiler::Instance().BeginCpu(name);
+  }
+  ~CpuProfileScope() {
+    if (active)
+      Profiler::Instance().EndCpu();
+  }
+  CpuProfileScope(const CpuProfileScope &) = delete;
+  CpuProfileScope &operator=(const CpuProfileScope &) = delete;
+
+private:
+  bool active;
+};
+
+// Times its enclosing scope on both the CPU and the GPU.
+class GpuProfileScope {
+public:
+  explicit GpuProfileScope(const char *name)
+      : cpu(name), active(Profiler::Instance().Enabled()) {
+    if (active)
+      Profiler::Instance().BeginGpu(name);
+  }
+  ~GpuProfileScope() {
+    if (active)
+      Profiler::Instance().EndGpu();
+  }
+  GpuProfileScope(const GpuProfileScope &) = delete;
+  GpuProfileScope &operator=(const GpuProfileScope &) = delete;
+
+private:
+  CpuProfileScope cpu;
+  bool active;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_CPU(name)                                                  \
+  CpuProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_GPU(name)                                                  \
+  GpuProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+
+#endif
@@ -0,0 +1,94 @@
+#include "RingBuffer.h"
+#include "GLStateCache.h"
+#include "glad/glad.h"
+#include <chrono>
+
+RingBuffer::RingBuffer(unsigned int target, size_t frameSize)
+    : target(target), frameSize(frameSize),
+      persistent(GLAD_GL_VERSION_4_4) {
+  glGenBuffers(1, &buffer);
+  GLStateCache::Instance().BindBuffer(target, buffer);
+  GLsizeiptr totalSize = (GLsizeiptr)(frameSize * FRAME_COUNT);
+  if (persistent) {
+    GLbitfield flags =
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(target, totalSize, nullptr, flags);
+    mapped = (unsigned char *)glMapBufferRange(target, 0, totalSize, flags);
+  } else {
+    glBufferData(target, totalSize, nullptr, GL_STREAM_DRAW);
+  }
+}
+
+RingBuffer::~RingBuffer() {
+  for (void *fence : fences)
+    if (fence)
+      glDeleteSync((GLsync)fence);
+  if (mapped) {
+    GLStateCache::Instance().BindBuffer(target, buffer);
+    glUnmapBuffer(target);
+  }
+  GLStateCache::Instance().DeleteBuffer(buffer);
+}
+
+void RingBuffer::BeginFrame() {
+  region = (region + 1) % FRAME_COUNT;
+  used = 0;
+
+  GLsync fence = (GLsync)fences[region];
+  ++waitStats.frames;
+  if (fence) {
+    // only time the wait when the GPU is actually behind
+    if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+      auto start = std::chrono::steady_clock::now();
+      GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+      while (glClientWaitSync(fence, flags, 1000000) == GL_TIMEOUT_EXPIRED)
+        flags = 0;
+      double ms = std::chrono::duration<double, std::milli>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+      ++waitStats.stalledFrames;
+      waitStats.totalMs += ms;
+      if (ms > waitStats.maxMs)
+        waitStats.maxMs = ms;
+    }
+    glDeleteSync(fence);
+    fences[region] = nullptr;
+  }
+
+  if (!persistent) {
+    // the fence above already guarantees the GPU is done with this region
+    GLStateCache::Instance().BindBuffer(target, buffer);
+    mapped = (unsigned char *)glMapBufferRange(
+        target, (GLintptr)(region * frameSize), (GLsizeiptr)frameSize,
+        GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT |
+            GL_MAP_INVALIDATE_RANGE_BIT);
+  }
+}
+
+void *RingBuffer::Allocate(size_t size, size_t alignment, size_t &offset) {
+  size_t start = (used + alignment - 1) / alignment * alignment;
+  if (!mapped || start + size > frameSize)
+    return nullptr;
+  used = start + size;
+  offset = region * frameSize + start;
+  return persistent ? mapped + offset : mapped + start;
+}
+
+void RingBuffer::FinishWrites() {
+  if (!persistent && mapped) {
+    GLStateCache::Instance().BindBuffer(target, buffer);
+    glUnmapBuffer(target);
+    mapped = nullptr;
+  }
+}
+
+void RingBuffer::EndFrame() {
+  FinishWrites();
+  fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+RingWaitStats RingBuffer::TakeWaitStats() {
+  RingWaitStats stats = waitStats;
+  waitStats = RingWaitStats();
+  return stats;
+}
@@ -0,0 +1,68 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <cstddef>
+
+// Fence wait time accumulated since the last TakeWaitStats call.
+struct RingWaitStats {
+  unsigned int frames = 0;
+  // frames whose region was still in use by the GPU
+  unsigned int stalledFrames = 0;
+  double totalMs = 0.0, maxMs = 0.0;
+};
+
+// Streaming buffer split into FRAME_COUNT regions, one written per frame.
+// Before a region is reused, BeginFrame waits on the fence placed when it
+// was last submitted, so the driver never has to synchronize implicitly.
+//
+// On a GL 4.4 context the buffer is mapped once, persistently and
+// coherently. Otherwise each region is mapped per frame with
+// GL_MAP_UNSYNCHRONIZED_BIT, which is safe because of the same fences.
+class RingBuffer {
+public:
+  static const int FRAME_COUNT = 3;
+
+  // target is the binding used for mapping on the fallback path.
+  RingBuffer(unsigned int target, size_t frameSize);
+  ~RingBuffer();
+
+  RingBuffer(const RingBuffer &) = delete;
+  RingBuffer &operator=(const RingBuffer &) = delete;
+
+  // Waits until the next region is free and makes it writable.
+  void BeginFrame();
+  // Reserves size bytes at an offset aligned to alignment and returns a
+  // write pointer, or nullptr if the frame's region is full. offset is
+  // relative to the start of the buffer, ready for attribute pointers or
+  // glBindBufferRange.
+  void *Allocate(size_t size, size_t alignment, size_t &offset);
+  // Ends writing for this frame; call before drawing from the buffer, since
+  // the fallback path has to unmap the region first.
+  void FinishWrites();
+  // Fences the region once the frame's draws have been issued.
+  void EndFrame();
+
+  unsigned int Buffer() const { return buffer; }
+  size_t FrameSize() const { return frameSize; }
+  bool IsPersistent() const { return persistent; }
+
+  // Returns the wait statistics gathered so far and resets them.
+  RingWaitStats TakeWaitStats();
+
+private:
+  unsigned int target;
+  unsigned int buffer = 0;
+  size_t frameSize;
+  bool persistent;
+
+  // whole buffer when persistent, the current region otherwise
+  unsigned char *mapped = nullptr;
+  // GLsync handles, one per region
+  void *fences[FRAME_COUNT] = {};
+  int region = 0;
+  size_t used = 0;
+
+  RingWaitStats waitStats;
+};
+
+#endif
@@ -1,32 +1,291 @@
 #include "Scene.h"
+#include "Frustum.h"
+#include "GLStateCache.h"
+#include "JobSystem.h"
+#include "OrbitKernel.h"
+#include "Profiler.h"
+#include "SceneFile.h"
+#include "glad/glad.h"
+#include <cstddef>
+#include <glm/gtc/matrix_transform.hpp>
+
+// Bodies per job; a multiple of the widest batch in OrbitKernel.
+const size_t UPDATE_CHUNK_SIZE = 4096;
+
+// Sphere LOD drawn for every body when orbits are evaluated on the GPU.
+const int GPU_ORBIT_LEVEL = 1;
+
+// Per-body instance data for the GPU orbit path; matches the attributes
+// of vertex_orbit.glsl.
+struct OrbitInstance {
+  float orbitRadius, orbitSpeed;
+  float size;
+  glm::vec3 color;
+};
+
+// Start of each instance stream within a ring buffer frame.
+const size_t INSTANCE_STREAM_ALIGNMENT = 16;
+
+// Below this many bodies the flat batched cull beats walking the BVH.
+const size_t BVH_CULL_MIN_BODIES = 256;
+
+// The built-in solar system, converted to BodyStore's layout at compile
+// time.
+constexpr BodyDesc SOLAR_SYSTEM_BODIES[] = {
+    {0.0f, 0.0f, 2.5f, 1.0f, 1.0f, 0.0f},    // Sun
+    {3.5f, 1.6f, 0.2f, 0.5f, 0.5f, 0.5f},    // Mercury
+    {5.0f, 1.2f, 0.4f, 1.0f, 0.8f, 0.4f},    // Venus
+    {7.0f, 1.0f, 0.5f, 0.2f, 0.5f, 1.0f},    // Earth
+    {9.5f, 0.8f, 0.4f, 1.0f, 0.3f, 0.3f},    // Mars
+    {13.0f, 0.4f, 1.2f, 0.9f, 0.7f, 0.5f},   // Jupiter
+    {17.0f, 0.3f, 1.0f, 0.9f, 0.8f, 0.6f},   // Saturn
+    {21.0f, 0.25f, 0.8f, 0.5f, 1.0f, 1.0f},  // Uranus
+    {25.0f, 0.2f, 0.7f, 0.3f, 0.5f, 1.0f},   // Neptune
+};
+constexpr auto SOLAR_SYSTEM = MakeBodyTable(SOLAR_SYSTEM_BODIES);
 
 Scene::Scene() {
-  // Sun
-  planets.emplace_back(0.0f, 0.0f, 2.5f, glm::vec3(1.0f, 1.0f, 0.0f));
-  // Mercury
-  planets.emplace_back(3.5f, 1.6f, 0.2f, glm::vec3(0.5f, 0.5f, 0.5f));
-  // Venus
-  planets.emplace_back(5.0f, 1.2f, 0.4f, glm::vec3(1.0f, 0.8f, 0.4f));
-  // Earth
-  planets.emplace_back(7.0f, 1.0f, 0.5f, glm::vec3(0.2f, 0.5f, 1.0f));
-  // Mars
-  planets.emplace_back(9.5f, 0.8f, 0.4f, glm::vec3(1.0f, 0.3f, 0.3f));
-  // Jupiter
-  planets.emplace_back(13.0f, 0.4f, 1.2f, glm::vec3(0.9f, 0.7f, 0.5f));
-  // Saturn
-  planets.emplace_back(17.0f, 0.3f, 1.0f, glm::vec3(0.9f, 0.8f, 0.6f));
-  // Uranus
-  planets.emplace_back(21.0f, 0.25f, 0.8f, glm::vec3(0.5f, 1.0f, 1.0f));
-  // Neptune
-  planets.emplace_back(25.0f, 0.2f, 0.7f, glm::vec3(0.3f, 0.5f, 1.0f));
-}
-
-void Scene::Update(float time) {
-  for (auto &p : planets)
-    p.Update(time);
-}
-
-void Scene::Render(Shader &shader, unsigned int VAO) {
-  for (auto &p : planets)
-    p.Draw(shader, VAO);
+  bodies.Assign(SOLAR_SYSTEM);
+  bvh.Build(bodies);
+}
+
+bool Scene::Load(const std::string &path) {
+  PROFILE_CPU("Scene::Load");
+  bool loaded = LoadSceneFile(path, bodies);
+  if (!loaded)
+    bodies.Assign(SOLAR_SYSTEM);
+  bodyVisible.clear();
+  bodyLevels.clear();
+  bvh.Build(bodies);
+  return loaded;
+}
+
+void Scene::Update(float time, JobSystem *jobs) {
+  PROFILE_CPU("Scene::Update");
+  if (!jobs)
+    UpdateOrbits(bodies, time, 0, bodies.Size());
+  else
+    jobs->ParallelFor(bodies.Size(), UPDATE_CHUNK_SIZE,
+                      [&](size_t begin, size_t end) {
+                        UpdateOrbits(bodies, time, begin, end);
+                      });
+  bvh.Refit(bodies);
+}
+
+int Scene::Pick(glm::vec3 origin, glm::vec3 dir) const {
+  float distance;
+  return bvh.Raycast(bodies, origin, dir, distance);
+}
+
+int Scene::NearestBody(glm::vec3 point, float &distance) const {
+  return bvh.Nearest(bodies, point, distance);
+}
+
+glm::vec3 ViewRayDirection(const RenderView &view, float x, float y) {
+  glm::vec2 ndc(2.0f * x / view.viewportWidth - 1.0f,
+                1.0f - 2.0f * y / view.viewportHeight);
+  glm::mat4 inv = glm::inverse(view.projection * view.view);
+  glm::vec4 near = inv * glm::vec4(ndc.x, ndc.y, -1.0f, 1.0f);
+  glm::vec4 far = inv * glm::vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+  return glm::normalize(glm::vec3(far) / far.w - glm::vec3(near) / near.w);
+}
+
+void Scene::PrepareDraw(const SphereLODSet &spheres,
+                        const RenderView &view) {
+  PROFILE_CPU("Scene::PrepareDraw");
+  size_t count = bodies.Size();
+  bodyVisible.resize(count);
+  Frustum frustum = Frustum::FromMatrix(view.projection * view.view);
+  if (count >= BVH_CULL_MIN_BODIES)
+    cullStats.visible = bvh.QueryFrustum(bodies, frustum, bodyVisible.data());
+  else
+    cullStats.visible = CullSpheres(frustum, bodies.position.data(),
+                                    bodies.size.data(), count,
+                                    bodyVisible.data());
+  cullStats.culled = count - cullStats.visible;
+
+  bodyLevels.resize(count, -1);
+  // projection[1][1] is 1 / tan(fovy / 2), so this maps a radius at unit
+  // distance to pixels
+  float pixelScale = 0.5f * view.viewportHeight * view.projection[1][1];
+
+  for (size_t i = 0; i < count; ++i) {
+    // culled bodies keep their last level for hysteresis
+    if (!bodyVisible[i])
+      continue;
+    float size = bodies.size[i];
+    float distance = glm::length(bodies.position[i] - view.cameraPos);
+    float radiusPixels = size * pixelScale / glm::max(distance, size);
+    bodyLevels[i] =
+        (signed char)spheres.SelectLevel(radiusPixels, bodyLevels[i]);
+  }
+}
+
+void Scene::Render(Shader &shader, const SphereLODSet &spheres,
+                   const RenderView &view) {
+  PROFILE_GPU("Scene::Render");
+  PrepareDraw(spheres, view);
+
+  // record the visible bodies, then draw them grouped by LOD mesh and
+  // front to back within each group
+  drawBucket.Clear();
+  for (size_t i = 0; i < bodies.Size(); ++i) {
+    if (!bodyVisible[i])
+      continue;
+    const SphereMesh &mesh = spheres.GetLevel(bodyLevels[i]);
+    float depth = -(view.view * glm::vec4(bodies.position[i], 1.0f)).z;
+    drawBucket.Add(MakeSortKey(shader.ID, 0, mesh.VAO, depth),
+                   (unsigned int)i);
+  }
+  drawBucket.Sort();
+
+  int modelLoc = shader.getUniformLocation("model");
+  int colorLoc = shader.getUniformLocation("objectColor");
+  GLStateCache &state = GLStateCache::Instance();
+  drawBucket.Submit([&](unsigned int i) {
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), bodies.position[i]);
+    model = glm::scale(model, glm::vec3(bodies.size[i]));
+    shader.setMat4(modelLoc, model);
+    shader.setVec3(colorLoc, bodies.color[i]);
+
+    const SphereMesh &mesh = spheres.GetLevel(bodyLevels[i]);
+    state.BindVertexArray(mesh.VAO);
+    glDrawElements(GL_TRIANGLES, mesh.indexCount, mesh.indexType, 0);
+  });
+}
+
+void Scene::InitInstancing(const SphereLODSet &spheres) {
+  // room for every body in each stream, plus alignment padding
+  size_t frameSize =
+      bodies.Size() * (2 * sizeof(glm::vec3) + sizeof(float)) +
+      3 * INSTANCE_STREAM_ALIGNMENT;
+  instanceRing.reset(new RingBuffer(GL_ARRAY_BUFFER, frameSize));
+
+  // attribute pointers are set per frame in RenderInstanced, since each
+  // LOD starts at a different offset into the streams
+  for (int i = 0; i < SphereLODSet::LEVEL_COUNT; ++i) {
+    GLStateCache::Instance().BindVertexArray(spheres.GetLevel(i).VAO);
+    for (int attrib = 2; attrib <= 4; ++attrib) {
+      glEnableVertexAttribArray(attrib);
+      glVertexAttribDivisor(attrib, 1);
+    }
+  }
+}
+
+RingWaitStats Scene::TakeStreamWaitStats() {
+  return instanceRing ? instanceRing->TakeWaitStats() : RingWaitStats();
+}
+
+void Scene::Destroy() {
+  // the ring unmaps and deletes its buffer, which needs the context
+  instanceRing.reset();
+  if (orbitVBO)
+    GLStateCache::Instance().DeleteBuffer(orbitVBO);
+  orbitVBO = 0;
+}
+
+void Scene::RenderInstanced(const SphereLODSet &spheres,
+                            const RenderView &view) {
+  PROFILE_GPU("Scene::RenderInstanced");
+  PrepareDraw(spheres, view);
+
+  // counting sort of the visible bodies by level so each LOD draws one
+  // contiguous instance range
+  size_t first[SphereLODSet::LEVEL_COUNT + 1] = {};
+  for (size_t i = 0; i < bodies.Size(); ++i)
+    if (bodyVisible[i])
+      ++first[bodyLevels[i] + 1];
+  for (int i = 0; i < SphereLODSet::LEVEL_COUNT; ++i)
+    first[i + 1] += first[i];
+
+  // scatter straight into this frame's region of the ring buffer
+  size_t count = cullStats.visible;
+  instanceRing->BeginFrame();
+  size_t positionOffset, sizeOffset, colorOffset;
+  glm::vec3 *positions = (glm::vec3 *)instanceRing->Allocate(
+      count * sizeof(glm::vec3), INSTANCE_STREAM_ALIGNMENT, positionOffset);
+  float *sizes = (float *)instanceRing->Allocate(
+      count * sizeof(float), INSTANCE_STREAM_ALIGNMENT, sizeOffset);
+  glm::vec3 *colors = (glm::vec3 *)instanceRing->Allocate(
+      count * sizeof(glm::vec3), INSTANCE_STREAM_ALIGNMENT, colorOffset);
+  if (!positions || !sizes || !colors) {
+    // bodies were added after InitInstancing sized the ring
+    instanceRing->EndFrame();
+    return;
+  }
+
+  size_t next[SphereLODSet::LEVEL_COUNT];
+  for (int i = 0; i < SphereLODSet::LEVEL_COUNT; ++i)
+    next[i] = first[i];
+  for (size_t i = 0; i < bodies.Size(); ++i) {
+    if (!bodyVisible[i])
+      continue;
+    size_t slot = next[bodyLevels[i]]++;
+    positions[slot] = bodies.position[i];
+    sizes[slot] = bodies.size[i];
+    colors[slot] = bodies.color[i];
+  }
+  instanceRing->FinishWrites();
+
+  GLStateCache &state = GLStateCache::Instance();
+  state.BindBuffer(GL_ARRAY_BUFFER, instanceRing->Buffer());
+  for (int i = 0; i < SphereLODSet::LEVEL_COUNT; ++i) {
+    GLsizei instances = (GLsizei)(first[i + 1] - first[i]);
+    if (instances == 0)
+      continue;
+    const SphereMesh &mesh = spheres.GetLevel(i);
+    state.BindVertexArray(mesh.VAO);
+
+    glVertexAttribPointer(
+        2, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3),
+        (void *)(positionOffset + first[i] * sizeof(glm::vec3)));
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(float),
+                          (void *)(sizeOffset + first[i] * sizeof(float)));
+    glVertexAttribPointer(
+        4, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3),
+        (void *)(colorOffset + first[i] * sizeof(glm::vec3)));
+
+    glDrawElementsInstanced(GL_TRIANGLES, mesh.indexCount, mesh.indexType, 0,
+                            instances);
+  }
+  instanceRing->EndFrame();
+}
+
+void Scene::InitGPUOrbits(const SphereLODSet &spheres) {
+  std::vector<OrbitInstance> instances(bodies.Size());
+  for (size_t i = 0; i < bodies.Size(); ++i)
+    instances[i] = {bodies.orbitRadius[i], bodies.orbitSpeed[i],
+                    bodies.size[i], bodies.color[i]};
+
+  GLStateCache &state = GLStateCache::Instance();
+  state.BindVertexArray(spheres.GetLevel(GPU_ORBIT_LEVEL).VAO);
+  glGenBuffers(1, &orbitVBO);
+  state.BindBuffer(GL_ARRAY_BUFFER, orbitVBO);
+  glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(OrbitInstance),
+               instances.data(), GL_STATIC_DRAW);
+
+  GLsizei stride = sizeof(OrbitInstance);
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride,
+                        (void *)offsetof(OrbitInstance, orbitRadius));
+  glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride,
+                        (void *)offsetof(OrbitInstance, size));
+  glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride,
+                        (void *)offsetof(OrbitInstance, color));
+  for (int attrib = 2; attrib <= 4; ++attrib) {
+    glEnableVertexAttribArray(attrib);
+    glVertexAttribDivisor(attrib, 1);
+  }
+}
+
+void Scene::RenderGPUOrbits(Shader &shader, const SphereLODSet &spheres,
+                            float time) {
+  PROFILE_GPU("Scene::RenderGPUOrbits");
+  shader.setFloat(shader.getUniformLocation("time"), time);
+  cullStats.visible = bodies.Size();
+  cullStats.culled = 0;
+
+  const SphereMesh &mesh = spheres.GetLevel(GPU_ORBIT_LEVEL);
+  GLStateCache::Instance().BindVertexArray(mesh.VAO);
+  glDrawElementsInstanced(GL_TRIANGLES, mesh.indexCount, mesh.indexType, 0,
+                          (GLsizei)bodies.Size());
 }
@@ -1,10 +1,98 @@
-#include "Planet.h"
-#include <vector>
+#include "BVH.h"
+#include "BodyStore.h"
+#include "CommandBucket.h"
+#include "RingBuffer.h"
+#include "Shader.h"
+#include "SphereLOD.h"
+#include <memory>
+#include <string>
+
+class JobSystem;
+
+// Frustum culling results from the last Render/RenderInstanced call.
+struct CullStats {
+  size_t visible = 0;
+  size_t culled = 0;
+};
+
+// Camera state needed to pick a level of detail per body.
+struct RenderView {
+  glm::mat4 view;
+  glm::mat4 projection;
+  glm::vec3 cameraPos;
+  float viewportWidth, viewportHeight;
+};
+
+// World-space direction of the ray from the camera through pixel (x, y),
+// measured from the top-left corner of the viewport.
+glm::vec3 ViewRayDirection(const RenderView &view, float x, float y);
 
 class Scene {
 public:
-  std::vector<Planet> planets;
+  BodyStore bodies;
+  // Starts with the built-in solar system.
   Scene();
-  void Update(float time);
-  void Render(Shader &shader, unsigned int VAO);
+  // Replaces the bodies with those of a scene file (see SceneFile.h), or
+  // restores the built-in system if it cannot be read. Call it before
+  // InitInstancing or InitGPUOrbits, which size buffers by body count.
+  bool Load(const std::string &path);
+  // Splits the orbit update into chunks on jobs, or runs it inline if null.
+  void Update(float time, JobSystem *jobs = nullptr);
+  void Render(Shader &shader, const SphereLODSet &spheres,
+              const RenderView &view);
+
+  // Creates the ring buffer that streams per-instance position/size/color
+  // and enables those attributes on every sphere LOD VAO (locations 2-4).
+  void InitInstancing(const SphereLODSet &spheres);
+  // Draws every body with one glDrawElementsInstanced call per sphere LOD.
+  // Everything comes from the frame uniform block and the instance
+  // streams, so the caller only binds the program.
+  void RenderInstanced(const SphereLODSet &spheres, const RenderView &view);
+
+  // Uploads orbit parameters, size and color of every body once into a
+  // static instance buffer on one sphere LOD VAO (locations 2-4).
+  void InitGPUOrbits(const SphereLODSet &spheres);
+  // Draws every body with a single instanced call; the vertex shader
+  // computes orbit positions from time, so nothing is uploaded per frame.
+  // Bodies are neither culled nor given per-body LODs in this mode.
+  void RenderGPUOrbits(Shader &shader, const SphereLODSet &spheres,
+                       float time);
+
+  const CullStats &GetCullStats() const { return cullStats; }
+  // Fence waits of the instance ring buffer since the last call; empty
+  // unless InitInstancing was called.
+  RingWaitStats TakeStreamWaitStats();
+
+  // Releases the instance ring buffer and the orbit buffer; call while
+  // the GL context is still current.
+  void Destroy();
+
+  // Closest body hit by the ray, or -1. Uses positions from the last Update.
+  int Pick(glm::vec3 origin, glm::vec3 dir) const;
+  // Body whose surface is closest to point, or -1 if the scene is empty.
+  int NearestBody(glm::vec3 point, float &distance) const;
+
+private:
+  // refitted after every Update; drives culling of large scenes, picking
+  // and nearest-body queries
+  BodyBVH bvh;
+
+  // 1 if the body's bounding sphere intersects the view frustum
+  std::vector<unsigned char> bodyVisible;
+  CullStats cullStats;
+
+  // per-body draws of Render, sorted by mesh and depth; holds body indices
+  CommandBucket<unsigned int> drawBucket;
+
+  // LOD chosen for each body last frame, used for hysteresis
+  std::vector<signed char> bodyLevels;
+
+  // per-frame instance streams, grouped by LOD
+  std::unique_ptr<RingBuffer> instanceRing;
+  // static per-body orbit data for RenderGPUOrbits
+  unsigned int orbitVBO = 0;
+
+  // Culls bodies against the view frustum, then picks an LOD for each
+  // visible one.
+  void PrepareDraw(const SphereLODSet &spheres, const RenderView &view);
 };
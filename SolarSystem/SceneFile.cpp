@@ -0,0 +1,133 @@
+#include "SceneFile.h"
+#include "BodyStore.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const char SCENE_MAGIC[4] = {'S', 'S', 'C', 'N'};
+const size_t HEADER_SIZE = 12;
+const size_t RECORD_FLOATS = 6;
+const size_t RECORD_SIZE = RECORD_FLOATS * 4;
+// Records decoded per fread; 24 KiB on the stack.
+const size_t BLOCK_RECORDS = 1024;
+
+uint32_t ReadU32(const unsigned char *p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+         (uint32_t)p[3] << 24;
+}
+
+float ReadF32(const unsigned char *p) {
+  uint32_t bits = ReadU32(p);
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+void WriteU32(unsigned char *p, uint32_t value) {
+  p[0] = (unsigned char)value;
+  p[1] = (unsigned char)(value >> 8);
+  p[2] = (unsigned char)(value >> 16);
+  p[3] = (unsigned char)(value >> 24);
+}
+
+void WriteF32(unsigned char *p, float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  WriteU32(p, bits);
+}
+
+bool Fail(FILE *f, const std::string &path, const char *reason) {
+  std::fprintf(stderr, "[SCENE] %s: %s\n", path.c_str(), reason);
+  if (f)
+    std::fclose(f);
+  return false;
+}
+
+} // namespace
+
+bool LoadSceneFile(const std::string &path, BodyStore &bodies) {
+  bodies.Clear();
+  FILE *f = std::fopen(path.c_str(), "rb");
+  if (!f)
+    return Fail(f, path, "cannot open");
+
+  unsigned char header[HEADER_SIZE];
+  if (std::fread(header, 1, HEADER_SIZE, f) != HEADER_SIZE ||
+      std::memcmp(header, SCENE_MAGIC, 4) != 0)
+    return Fail(f, path, "not a scene file");
+  if (ReadU32(header + 4) != SCENE_FILE_VERSION)
+    return Fail(f, path, "unsupported version");
+  size_t count = ReadU32(header + 8);
+
+  // check the count against the file size before trusting it to size the
+  // arrays
+  long start = std::ftell(f);
+  if (std::fseek(f, 0, SEEK_END) != 0)
+    return Fail(f, path, "cannot seek");
+  long end = std::ftell(f);
+  std::fseek(f, start, SEEK_SET);
+  if (end - start != (long)(count * RECORD_SIZE))
+    return Fail(f, path, "body count does not match file size");
+
+  bodies.orbitRadius.resize(count);
+  bodies.orbitSpeed.resize(count);
+  bodies.size.resize(count);
+  bodies.color.resize(count);
+  bodies.position.resize(count);
+
+  unsigned char block[BLOCK_RECORDS * RECORD_SIZE];
+  for (size_t first = 0; first < count; first += BLOCK_RECORDS) {
+    size_t n = count - first < BLOCK_RECORDS ? count - first : BLOCK_RECORDS;
+    if (std::fread(block, RECORD_SIZE, n, f) != n) {
+      bodies.Clear();
+      return Fail(f, path, "truncated");
+    }
+    for (size_t j = 0; j < n; ++j) {
+      const unsigned char *r = block + j * RECORD_SIZE;
+      size_t i = first + j;
+      bodies.orbitRadius[i] = ReadF32(r);
+      bodies.orbitSpeed[i] = ReadF32(r + 4);
+      bodies.size[i] = ReadF32(r + 8);
+      bodies.color[i] =
+          glm::vec3(ReadF32(r + 12), ReadF32(r + 16), ReadF32(r + 20));
+      bodies.position[i] = glm::vec3(bodies.orbitRadius[i], 0.0f, 0.0f);
+    }
+  }
+  std::fclose(f);
+  return true;
+}
+
+bool SaveSceneFile(const std::string &path, const BodyStore &bodies) {
+  FILE *f = std::fopen(path.c_str(), "wb");
+  if (!f)
+    return Fail(f, path, "cannot write");
+
+  unsigned char header[HEADER_SIZE];
+  std::memcpy(header, SCENE_MAGIC, 4);
+  WriteU32(header + 4, SCENE_FILE_VERSION);
+  WriteU32(header + 8, (uint32_t)bodies.Size());
+  bool ok = std::fwrite(header, 1, HEADER_SIZE, f) == HEADER_SIZE;
+
+  unsigned char block[BLOCK_RECORDS * RECORD_SIZE];
+  for (size_t first = 0; ok && first < bodies.Size();
+       first += BLOCK_RECORDS) {
+    size_t n = bodies.Size() - first < BLOCK_RECORDS ? bodies.Size() - first
+                                                      : BLOCK_RECORDS;
+    for (size_t j = 0; j < n; ++j) {
+      unsigned char *r = block + j * RECORD_SIZE;
+      size_t i = first + j;
+      WriteF32(r, bodies.orbitRadius[i]);
+      WriteF32(r + 4, bodies.orbitSpeed[i]);
+      WriteF32(r + 8, bodies.size[i]);
+      WriteF32(r + 12, bodies.color[i].x);
+      WriteF32(r + 16, bodies.color[i].y);
+      WriteF32(r + 20, bodies.color[i].z);
+    }
+    ok = std::fwrite(block, RECORD_SIZE, n, f) == n;
+  }
+  if (std::fclose(f) != 0 || !ok)
+    return Fail(nullptr, path, "write failed");
+  return true;
+}
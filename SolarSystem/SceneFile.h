@@ -0,0 +1,27 @@
+#ifndef SCENE_FILE_H
+#define SCENE_FILE_H
+
+#include <string>
+
+class BodyStore;
+
+// Binary scene files: a 12-byte header followed by one 24-byte record per
+// body, all little-endian.
+//
+//   char     magic[4]     "SSCN"
+//   uint32   version      SCENE_FILE_VERSION
+//   uint32   bodyCount
+//   bodyCount x { float orbitRadius, orbitSpeed, size, r, g, b }
+//
+// Record fields are in BodyDesc order.
+const unsigned int SCENE_FILE_VERSION = 1;
+
+// Replaces the bodies with the file's. The arrays are sized once from the
+// header and records are decoded in fixed-size blocks, so the loader
+// allocates nothing beyond the body arrays regardless of scene size. On
+// failure the error is printed and bodies are left empty.
+bool LoadSceneFile(const std::string &path, BodyStore &bodies);
+
+bool SaveSceneFile(const std::string &path, const BodyStore &bodies);
+
+#endif
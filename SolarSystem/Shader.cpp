@@ -1,12 +1,16 @@
 #include "Shader.h"
+#include "GLStateCache.h"
+#include "Profiler.h"
 #include "glad/glad.h"
 #include <fstream>
 #include <iostream>
 #include <sstream>
 
-Shader::Shader(const std::string &vertexPath, const std::string &fragmentPath) {
-  std::string vCode = loadShaderSource(vertexPath);
-  std::string fCode = loadShaderSource(fragmentPath);
+Shader::Shader(const std::string &vertexPath, const std::string &fragmentPath,
+               const std::string &defines) {
+  PROFILE_CPU("Shader compile");
+  std::string vCode = loadShaderSource(vertexPath, defines);
+  std::string fCode = loadShaderSource(fragmentPath, defines);
   const char *vShaderCode = vCode.c_str();
   const char *fShaderCode = fCode.c_str();
 
@@ -28,34 +32,71 @@ Shader::Shader(const std::string &vertexPath, const std::string &fragmentPath) {
 
   glDeleteShader(vertex);
   glDeleteShader(fragment);
+
+  reflectUniforms();
 }
 
-void Shader::use() const { glUseProgram(ID); }
+void Shader::use() const { GLStateCache::Instance().UseProgram(ID); }
+
+int Shader::getUniformLocation(const std::string &name) const {
+  auto it = uniformLocations.find(name);
+  if (it != uniformLocations.end())
+    return it->second;
+  if (missingUniforms.insert(name).second)
+    std::cerr << "[SHADER::UNIFORM] '" << name
+              << "' is not an active uniform in program " << ID << '\n';
+  return -1;
+}
+
+void Shader::bindUniformBlock(const std::string &blockName,
+                              unsigned int binding) const {
+  unsigned int index = glGetUniformBlockIndex(ID, blockName.c_str());
+  if (index != GL_INVALID_INDEX)
+    glUniformBlockBinding(ID, index, binding);
+}
 
 void Shader::setBool(const std::string &name, bool value) const {
-  glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+  glUniform1i(getUniformLocation(name), (int)value);
 }
 void Shader::setInt(const std::string &name, int value) const {
-  glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+  glUniform1i(getUniformLocation(name), value);
 }
 void Shader::setFloat(const std::string &name, float value) const {
-  glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+  glUniform1f(getUniformLocation(name), value);
 }
 void Shader::setVec3(const std::string &name, const glm::vec3 &value) const {
-  glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+  glUniform3fv(getUniformLocation(name), 1, &value[0]);
 }
 void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const {
-  glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
-                     &mat[0][0]);
+  glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
+}
+
+void Shader::setInt(int location, int value) const {
+  glUniform1i(location, value);
+}
+void Shader::setFloat(int location, float value) const {
+  glUniform1f(location, value);
+}
+void Shader::setVec3(int location, const glm::vec3 &value) const {
+  glUniform3fv(location, 1, &value[0]);
+}
+void Shader::setMat4(int location, const glm::mat4 &mat) const {
+  glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
 }
 
-std::string Shader::loadShaderSource(const std::string &filePath) {
+std::string Shader::loadShaderSource(const std::string &filePath,
+                                     const std::string &defines) {
   std::ifstream file(filePath);
   if (!file.is_open())
     throw std::runtime_error("Failed to open shader file: " + filePath);
   std::stringstream buffer;
   buffer << file.rdbuf();
-  return buffer.str();
+  std::string source = buffer.str();
+  // #version must stay the first line
+  size_t afterVersion = source.find('\n');
+  if (!defines.empty() && afterVersion != std::string::npos)
+    source.insert(afterVersion + 1, defines);
+  return source;
 }
 
 void Shader::checkCompileErrors(unsigned int shader, const std::string &type) {
@@ -76,3 +117,27 @@ void Shader::checkCompileErrors(unsigned int shader, const std::string &type) {
     }
   }
 }
+
+void Shader::reflectUniforms() {
+  int count = 0, maxLength = 0;
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+  std::string name(maxLength, '\0');
+  for (int i = 0; i < count; ++i) {
+    GLsizei length = 0;
+    GLint size = 0;
+    GLenum type = 0;
+    glGetActiveUniform(ID, i, maxLength, &length, &size, &type, &name[0]);
+    std::string uniform = name.substr(0, length);
+    int location = glGetUniformLocation(ID, uniform.c_str());
+    // members of uniform blocks have no location
+    if (location < 0)
+      continue;
+    uniformLocations[uniform] = location;
+    // arrays are reported as "name[0]"; also accept the bare name
+    size_t n = uniform.size();
+    if (n > 3 && uniform.compare(n - 3, 3, "[0]") == 0)
+      uniformLocations[uniform.substr(0, n - 3)] = location;
+  }
+}
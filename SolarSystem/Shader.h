@@ -3,22 +3,47 @@
 
 #include <glm/glm.hpp>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 class Shader {
 public:
   unsigned int ID;
 
-  Shader(const std::string &vertexPath, const std::string &fragmentPath);
+  // defines are inserted after each stage's #version line, so one source
+  // file can be compiled into several variants.
+  Shader(const std::string &vertexPath, const std::string &fragmentPath,
+         const std::string &defines = "");
   void use() const;
 
+  // Location of an active uniform from the table built after linking, or -1
+  // with a one-time warning if the program has no uniform by that name.
+  int getUniformLocation(const std::string &name) const;
+
+  // Points the named uniform block at a buffer binding point. Programs that
+  // do not declare the block are left untouched.
+  void bindUniformBlock(const std::string &blockName,
+                        unsigned int binding) const;
+
   void setBool(const std::string &name, bool value) const;
   void setInt(const std::string &name, int value) const;
   void setFloat(const std::string &name, float value) const;
   void setVec3(const std::string &name, const glm::vec3 &value) const;
   void setMat4(const std::string &name, const glm::mat4 &mat) const;
 
+  // Location-based setters skip the name lookup entirely.
+  void setInt(int location, int value) const;
+  void setFloat(int location, float value) const;
+  void setVec3(int location, const glm::vec3 &value) const;
+  void setMat4(int location, const glm::mat4 &mat) const;
+
 private:
-  std::string loadShaderSource(const std::string &filePath);
+  std::unordered_map<std::string, int> uniformLocations;
+  mutable std::unordered_set<std::string> missingUniforms;
+
+  void reflectUniforms();
+  std::string loadShaderSource(const std::string &filePath,
+                               const std::string &defines);
   void checkCompileErrors(unsigned int shader, const std::string &type);
 };
 #endif
@@ -1,10 +1,61 @@
 #include "Sphere.h"
+#include "GLStateCache.h"
 #include "glad/glad.h"
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <vector>
 
-unsigned int createSphereVAO(int sectorCount, int stackCount) {
-  std::vector<float> vertices;
+namespace {
+
+// Round-to-nearest float -> IEEE half. Sphere coordinates lie in [-1, 1],
+// so overflow to infinity cannot happen; tiny values flush to zero.
+uint16_t floatToHalf(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  uint16_t sign = (bits >> 16) & 0x8000;
+  int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+  uint32_t mantissa = bits & 0x7FFFFF;
+  if (exponent <= 0)
+    return sign;
+  uint16_t half =
+      sign | (uint16_t)(exponent << 10) | (uint16_t)(mantissa >> 13);
+  // round half up on the dropped mantissa bits; a carry bumps the exponent
+  if (mantissa & 0x1000)
+    ++half;
+  return half;
+}
+
+int8_t toSnorm8(float value) {
+  float clamped = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+  return (int8_t)std::lround(clamped * 127.0f);
+}
+
+// Octahedral mapping of a unit normal to [-1, 1]^2.
+void octahedralEncode(float x, float y, float z, float &u, float &v) {
+  float invL1 = 1.0f / (std::fabs(x) + std::fabs(y) + std::fabs(z));
+  u = x * invL1;
+  v = y * invL1;
+  if (z < 0.0f) {
+    float fu = (1.0f - std::fabs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+    float fv = (1.0f - std::fabs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+    u = fu;
+    v = fv;
+  }
+}
+
+struct PackedVertex {
+  uint16_t position[3];
+  int8_t normal[2];
+};
+static_assert(sizeof(PackedVertex) == 8, "packed sphere vertex is 8 bytes");
+
+} // namespace
+
+SphereMesh createSphereVAO(int sectorCount, int stackCount,
+                           SphereVertexFormat format) {
+  std::vector<float> positions;
   std::vector<unsigned int> indices;
 
   const float PI = 3.14159265359f;
@@ -20,13 +71,9 @@ unsigned int createSphereVAO(int sectorCount, int stackCount) {
       float x = xy * cosf(sectorAngle);
       float y = xy * sinf(sectorAngle);
 
-      vertices.push_back(x);
-      vertices.push_back(y);
-      vertices.push_back(z);
-      // for nomals only
-      vertices.push_back(x);
-      vertices.push_back(y);
-      vertices.push_back(z);
+      positions.push_back(x);
+      positions.push_back(y);
+      positions.push_back(z);
     }
   }
 
@@ -48,29 +95,105 @@ unsigned int createSphereVAO(int sectorCount, int stackCount) {
     }
   }
 
-  unsigned int VAO, VBO, EBO;
-  glGenVertexArrays(1, &VAO);
-  glGenBuffers(1, &VBO);
-  glGenBuffers(1, &EBO);
-
-  glBindVertexArray(VAO);
-
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float),
-               vertices.data(), GL_STATIC_DRAW);
+  size_t vertexCount = positions.size() / 3;
+  std::vector<float> fullVertices;
+  std::vector<PackedVertex> packedVertices;
+  const void *vertexData = positions.data();
+  size_t vertexBytes = positions.size() * sizeof(float);
+
+  if (format == SPHERE_POSITION_NORMAL) {
+    // unit sphere: the normal is the position
+    for (size_t v = 0; v < vertexCount; ++v)
+      for (int copy = 0; copy < 2; ++copy)
+        fullVertices.insert(fullVertices.end(), &positions[v * 3],
+                            &positions[v * 3] + 3);
+    vertexData = fullVertices.data();
+    vertexBytes = fullVertices.size() * sizeof(float);
+  } else if (format == SPHERE_HALF_OCTAHEDRAL) {
+    packedVertices.resize(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+      const float *p = &positions[v * 3];
+      float u, w;
+      octahedralEncode(p[0], p[1], p[2], u, w);
+      for (int c = 0; c < 3; ++c)
+        packedVertices[v].position[c] = floatToHalf(p[c]);
+      packedVertices[v].normal[0] = toSnorm8(u);
+      packedVertices[v].normal[1] = toSnorm8(w);
+    }
+    vertexData = packedVertices.data();
+    vertexBytes = packedVertices.size() * sizeof(PackedVertex);
+  }
 
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
-               indices.data(), GL_STATIC_DRAW);
+  SphereMesh mesh;
+  mesh.indexCount = (int)indices.size();
+  mesh.format = format;
+  glGenVertexArrays(1, &mesh.VAO);
+  glGenBuffers(1, &mesh.VBO);
+  glGenBuffers(1, &mesh.EBO);
+
+  GLStateCache &state = GLStateCache::Instance();
+  state.BindVertexArray(mesh.VAO);
+
+  state.BindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+  glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertexData, GL_STATIC_DRAW);
+
+  // 16-bit indices halve index bandwidth whenever the vertices allow it
+  state.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+  if (vertexCount <= UINT16_MAX) {
+    std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 shortIndices.size() * sizeof(uint16_t), shortIndices.data(),
+                 GL_STATIC_DRAW);
+    mesh.indexType = GL_UNSIGNED_SHORT;
+  } else {
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 indices.size() * sizeof(unsigned int), indices.data(),
+                 GL_STATIC_DRAW);
+    mesh.indexType = GL_UNSIGNED_INT;
+  }
 
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)0);
-  glEnableVertexAttribArray(0);
+  switch (format) {
+  case SPHERE_POSITION_NORMAL:
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
+                          (void *)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
+                          (void *)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    break;
+  case SPHERE_POSITION_ONLY:
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float),
+                          (void *)0);
+    glEnableVertexAttribArray(0);
+    break;
+  case SPHERE_HALF_OCTAHEDRAL:
+    glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex),
+                          (void *)offsetof(PackedVertex, position));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_BYTE, GL_TRUE, sizeof(PackedVertex),
+                          (void *)offsetof(PackedVertex, normal));
+    glEnableVertexAttribArray(1);
+    break;
+  }
 
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
-                        (void *)(3 * sizeof(float)));
-  glEnableVertexAttribArray(1);
+  return mesh;
+}
 
-  glBindVertexArray(0);
+void destroySphereMesh(SphereMesh &mesh) {
+  GLStateCache &state = GLStateCache::Instance();
+  state.DeleteVertexArray(mesh.VAO);
+  state.DeleteBuffer(mesh.VBO);
+  state.DeleteBuffer(mesh.EBO);
+  mesh = SphereMesh{};
+}
 
-  return VAO;
+const char *sphereShaderDefines(SphereVertexFormat format) {
+  switch (format) {
+  case SPHERE_POSITION_ONLY:
+    return "#define SPHERE_NORMAL_FROM_POSITION\n";
+  case SPHERE_HALF_OCTAHEDRAL:
+    return "#define SPHERE_OCTAHEDRAL_NORMAL\n";
+  default:
+    return "";
+  }
 }
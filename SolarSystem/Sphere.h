@@ -1,6 +1,29 @@
 #ifndef SPHERE_H
 #define SPHERE_H
 
-unsigned int createSphereVAO(int sectorCount = 36, int stackCount = 18);
+// Vertex layouts for generated spheres. On a unit sphere the normal equals
+// the position, so the compact layouts drop or shrink the normal and the
+// vertex shader rebuilds it (see sphereShaderDefines).
+enum SphereVertexFormat {
+  SPHERE_POSITION_NORMAL, // float position + float normal, 24 bytes
+  SPHERE_POSITION_ONLY,   // float position, normal = position, 12 bytes
+  SPHERE_HALF_OCTAHEDRAL  // half position + octahedral snorm8 normal, 8 bytes
+};
+
+// GL objects and draw parameters of a generated sphere.
+struct SphereMesh {
+  unsigned int VAO, VBO, EBO;
+  int indexCount;
+  // GL_UNSIGNED_SHORT when every vertex fits in 16 bits, else GL_UNSIGNED_INT
+  unsigned int indexType;
+  SphereVertexFormat format;
+};
+
+SphereMesh createSphereVAO(int sectorCount = 36, int stackCount = 18,
+                           SphereVertexFormat format = SPHERE_POSITION_NORMAL);
+void destroySphereMesh(SphereMesh &mesh);
+
+// Preprocessor lines the sphere vertex shaders need for a given format.
+const char *sphereShaderDefines(SphereVertexFormat format);
 
 #endif
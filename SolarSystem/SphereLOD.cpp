@@ -0,0 +1,45 @@
+#include "SphereLOD.h"
+#include "Sphere.h"
+
+namespace {
+
+// {sectors, stacks} per level, finest first. The coarsest level is 48
+// triangles; the original single mesh (36x18) is level 1.
+const int TESSELLATION[SphereLODSet::LEVEL_COUNT][2] = {
+    {48, 24}, {36, 18}, {20, 10}, {12, 6}, {8, 4}};
+
+// Smallest projected radius in pixels at which each level is used.
+const float MIN_RADIUS[SphereLODSet::LEVEL_COUNT] = {120.0f, 48.0f, 16.0f,
+                                                     6.0f, 0.0f};
+
+// Fraction a body may drift outside its current band before switching.
+const float HYSTERESIS = 0.15f;
+
+} // namespace
+
+SphereLODSet::SphereLODSet(SphereVertexFormat format) {
+  for (int i = 0; i < LEVEL_COUNT; ++i)
+    levels[i] =
+        createSphereVAO(TESSELLATION[i][0], TESSELLATION[i][1], format);
+}
+
+void SphereLODSet::Destroy() {
+  for (int i = 0; i < LEVEL_COUNT; ++i)
+    destroySphereMesh(levels[i]);
+}
+
+int SphereLODSet::SelectLevel(float radiusPixels, int previousLevel) const {
+  if (previousLevel >= 0 && previousLevel < LEVEL_COUNT) {
+    float lower = MIN_RADIUS[previousLevel] * (1.0f - HYSTERESIS);
+    bool belowUpper = previousLevel == 0 ||
+                      radiusPixels < MIN_RADIUS[previousLevel - 1] *
+                                         (1.0f + HYSTERESIS);
+    if (radiusPixels >= lower && belowUpper)
+      return previousLevel;
+  }
+
+  int level = 0;
+  while (level < LEVEL_COUNT - 1 && radiusPixels < MIN_RADIUS[level])
+    ++level;
+  return level;
+}
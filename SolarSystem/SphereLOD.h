@@ -0,0 +1,27 @@
+#ifndef SPHERE_LOD_H
+#define SPHERE_LOD_H
+
+#include "Sphere.h"
+
+// Sphere meshes at decreasing tessellation, generated once at startup, and
+// the projected-size thresholds used to choose between them.
+class SphereLODSet {
+public:
+  static const int LEVEL_COUNT = 5;
+
+  explicit SphereLODSet(SphereVertexFormat format = SPHERE_POSITION_NORMAL);
+  const SphereMesh &GetLevel(int level) const { return levels[level]; }
+  // Releases every level; call while the GL context is still current.
+  void Destroy();
+
+  // Finest level whose minimum projected radius (in pixels) is met. A body
+  // stays at previousLevel while it is within the hysteresis margin of that
+  // level's band, so sizes hovering at a threshold do not pop back and forth.
+  // Pass a negative previousLevel when there is no history.
+  int SelectLevel(float radiusPixels, int previousLevel) const;
+
+private:
+  SphereMesh levels[LEVEL_COUNT];
+};
+
+#endif
@@ -0,0 +1,63 @@
+// Measures how the chunked orbit update scales with worker count and checks
+// that every thread count produces bit-identical positions.
+// Build from SolarSystem/ (the bench needs no GL context):
+//   g++ -O2 -std=c++17 -pthread -I. -o jobs_bench bench/jobs_bench.cpp
+//       BodyStore.cpp JobSystem.cpp OrbitKernel.cpp
+// Usage: ./jobs_bench [bodyCount] [frames]
+#include "BodyStore.h"
+#include "JobSystem.h"
+#include "OrbitKernel.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const size_t CHUNK_SIZE = 4096;
+
+int main(int argc, char **argv) {
+  size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1 << 22;
+  int frames = argc > 2 ? std::atoi(argv[2]) : 50;
+
+  BodyStore bodies;
+  bodies.Reserve(count);
+  srand(1);
+  for (size_t i = 0; i < count; ++i)
+    bodies.Add(3.0f + 40.0f * rand() / RAND_MAX,
+               0.05f + 2.0f * rand() / RAND_MAX, 0.1f, glm::vec3(1.0f));
+
+  unsigned int maxThreads = JobSystem::DefaultWorkerCount() + 1;
+  std::printf("bodies %zu, frames %d, kernel %s\n", count, frames,
+              OrbitKernelName());
+  std::printf("threads  ms/frame  speedup  identical\n");
+
+  std::vector<glm::vec3> reference;
+  double baseline = 0.0;
+  for (unsigned int threads = 1; threads <= maxThreads; ++threads) {
+    JobSystem jobs(threads - 1);
+    auto update = [&](float time) {
+      jobs.ParallelFor(count, CHUNK_SIZE, [&](size_t begin, size_t end) {
+        UpdateOrbits(bodies, time, begin, end);
+      });
+    };
+
+    update(0.0f); // warm up the pool
+    auto start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; ++f)
+      update(f * (1.0f / 60.0f));
+    auto end = std::chrono::steady_clock::now();
+    double ms =
+        std::chrono::duration<double, std::milli>(end - start).count() / frames;
+
+    bool identical = true;
+    if (threads == 1) {
+      reference = bodies.position;
+      baseline = ms;
+    } else {
+      identical = std::memcmp(reference.data(), bodies.position.data(),
+                              count * sizeof(glm::vec3)) == 0;
+    }
+    std::printf("%7u  %8.3f  %6.2fx  %s\n", threads, ms, baseline / ms,
+                identical ? "yes" : "NO");
+  }
+  return 0;
+}
@@ -0,0 +1,63 @@
+// Compares the dispatched orbit kernel against the original scalar loop.
+// Build from SolarSystem/ (the bench needs no GL context):
+//   g++ -O2 -std=c++17 -I. -o orbit_bench bench/orbit_bench.cpp
+//       BodyStore.cpp OrbitKernel.cpp
+// Usage: ./orbit_bench [bodyCount] [frames]
+#include "BodyStore.h"
+#include "OrbitKernel.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+// The per-body loop Planet::Update used before the SIMD kernel.
+static void UpdateOrbitsReference(BodyStore &bodies, float time) {
+  for (size_t i = 0; i < bodies.Size(); ++i) {
+    float angle = bodies.orbitSpeed[i] * time;
+    bodies.position[i] = glm::vec3(bodies.orbitRadius[i] * cos(angle), 0.0f,
+                                   bodies.orbitRadius[i] * sin(angle));
+  }
+}
+
+template <typename F> static double NanosecondsPerBody(F update, size_t count,
+                                                      int frames) {
+  auto start = std::chrono::steady_clock::now();
+  for (int f = 0; f < frames; ++f)
+    update(f * (1.0f / 60.0f));
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         (double(count) * frames);
+}
+
+int main(int argc, char **argv) {
+  size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1 << 20;
+  int frames = argc > 2 ? std::atoi(argv[2]) : 100;
+
+  BodyStore bodies;
+  bodies.Reserve(count);
+  srand(1);
+  for (size_t i = 0; i < count; ++i)
+    bodies.Add(3.0f + 40.0f * rand() / RAND_MAX,
+               0.05f + 2.0f * rand() / RAND_MAX, 0.1f, glm::vec3(1.0f));
+
+  double reference = NanosecondsPerBody(
+      [&](float t) { UpdateOrbitsReference(bodies, t); }, count, frames);
+  BodyStore expected = bodies;
+
+  double kernel = NanosecondsPerBody(
+      [&](float t) { UpdateOrbits(bodies, t, 0, bodies.Size()); }, count,
+      frames);
+
+  float maxError = 0.0f;
+  for (size_t i = 0; i < count; ++i) {
+    glm::vec3 d = bodies.position[i] - expected.position[i];
+    maxError = std::fmax(maxError, std::fmax(std::fabs(d.x), std::fabs(d.z)));
+  }
+
+  std::printf("bodies %zu, frames %d\n", count, frames);
+  std::printf("scalar libm : %6.2f ns/body\n", reference);
+  std::printf("%-12s: %6.2f ns/body (%.1fx)\n", OrbitKernelName(), kernel,
+              reference / kernel);
+  std::printf("max position error %.3g\n", maxError);
+  return 0;
+}
@@ -0,0 +1,50 @@
+// Writes a generated scene file, times loading it back and checks that
+// every body round-trips exactly. Also serves to produce large test scenes
+// for --scene=.
+// Build from SolarSystem/ (the bench needs no GL context):
+//   g++ -O2 -std=c++17 -I. -o scene_bench bench/scene_bench.cpp
+//       BodyStore.cpp SceneFile.cpp
+// Usage: ./scene_bench [bodyCount] [path]
+#include "BodyStore.h"
+#include "SceneFile.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char **argv) {
+  size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 500000;
+  const char *path = argc > 2 ? argv[2] : "bench_scene.bin";
+
+  BodyStore written;
+  written.Reserve(count);
+  srand(1);
+  for (size_t i = 0; i < count; ++i)
+    written.Add(3.0f + 40.0f * rand() / RAND_MAX,
+                0.1f + 2.0f * rand() / RAND_MAX,
+                0.05f + 0.3f * rand() / RAND_MAX,
+                glm::vec3((float)rand() / RAND_MAX, (float)rand() / RAND_MAX,
+                          (float)rand() / RAND_MAX));
+  if (!SaveSceneFile(path, written))
+    return 1;
+
+  BodyStore loaded;
+  auto start = std::chrono::steady_clock::now();
+  if (!LoadSceneFile(path, loaded))
+    return 1;
+  double ms = std::chrono::duration<double, std::milli>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+
+  size_t mismatches = loaded.Size() == count ? 0 : count;
+  for (size_t i = 0; i < loaded.Size() && i < count; ++i)
+    if (loaded.orbitRadius[i] != written.orbitRadius[i] ||
+        loaded.orbitSpeed[i] != written.orbitSpeed[i] ||
+        loaded.size[i] != written.size[i] ||
+        loaded.color[i] != written.color[i])
+      ++mismatches;
+
+  std::printf("%zu bodies loaded in %.2f ms (%.1f ns/body), %zu mismatches\n",
+              loaded.Size(), ms, ms * 1.0e6 / (count ? count : 1),
+              mismatches);
+  return mismatches == 0 ? 0 : 1;
+}
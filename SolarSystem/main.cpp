@@ -1,72 +1,265 @@
 #include "Camera.h"
+#include "FrameBench.h"
+#include "FrameUniforms.h"
+#include "GLStateCache.h"
+#include "Headless.h"
+#include "JobSystem.h"
+#include "Profiler.h"
 #include "Scene.h"
 #include "Shader.h"
-#include "Sphere.h"
+#include "SphereLOD.h"
 #include "glad/glad.h"
 #include <GLFW/glfw3.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
 
 Camera camera(glm::vec3(0.0f, 5.0f, 20.0f));
 float lastX = 1280 / 2, lastY = 720 / 2;
 float deltaTime = 0.0f, lastFrame = 0.0f;
 bool firstMouse = true;
+bool pickRequested = false;
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
+int viewportWidth = SCR_WIDTH, viewportHeight = SCR_HEIGHT;
 
 void processInput(GLFWwindow *window);
 void mouse_callback(GLFWwindow *window, double xpos, double ypos);
+void mouse_button_callback(GLFWwindow *window, int button, int action,
+                           int mods);
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
-int main() {
-  glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-  GLFWwindow *window =
-      glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "GL 3D Solar System", NULL, NULL);
-  glfwMakeContextCurrent(window);
-  glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-  glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-  glfwSetCursorPosCallback(window, mouse_callback);
-  gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
-  glEnable(GL_DEPTH_TEST);
-
-  Shader shader("resources/shaders/vertex.glsl",
-                "resources/shaders/fragment.glsl");
-
-  unsigned int VAO = createSphereVAO();
+int main(int argc, char **argv) {
+  // --instanced draws every body with one instanced draw call
+  // --gpu-orbits computes orbit positions in the vertex shader instead
+  // --vertex-format=position|packed selects a compact sphere vertex layout
+  // --scene=path loads the bodies from a scene file instead
+  // --headless renders offscreen without a display and exits after
+  // --frames=N frames
+  // --bench steps a fixed clock and writes frame timings to --bench-report
+  // (.json summary or .csv samples) after --bench-warmup and
+  // --bench-frames frames
+  // --profile prints per-scope CPU/GPU times once a second; with
+  // --profile=trace.json it also writes a Chrome trace on exit
+  bool instanced = false, gpuOrbits = false, headless = false;
+  bool benchMode = false, profile = false;
+  long frameLimit = 300;
+  int benchWarmup = 100, benchFrames = 1000;
+  std::string benchReport = "bench.json", profileTrace, scenePath;
+  SphereVertexFormat vertexFormat = SPHERE_POSITION_NORMAL;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--instanced") == 0)
+      instanced = true;
+    else if (std::strcmp(argv[i], "--gpu-orbits") == 0)
+      gpuOrbits = true;
+    else if (std::strcmp(argv[i], "--vertex-format=position") == 0)
+      vertexFormat = SPHERE_POSITION_ONLY;
+    else if (std::strcmp(argv[i], "--vertex-format=packed") == 0)
+      vertexFormat = SPHERE_HALF_OCTAHEDRAL;
+    else if (std::strncmp(argv[i], "--scene=", 8) == 0)
+      scenePath = argv[i] + 8;
+    else if (std::strcmp(argv[i], "--headless") == 0)
+      headless = true;
+    else if (std::strncmp(argv[i], "--frames=", 9) == 0)
+      frameLimit = std::atol(argv[i] + 9);
+    else if (std::strcmp(argv[i], "--bench") == 0)
+      benchMode = true;
+    else if (std::strncmp(argv[i], "--bench-warmup=", 15) == 0)
+      benchWarmup = std::atoi(argv[i] + 15);
+    else if (std::strncmp(argv[i], "--bench-frames=", 15) == 0)
+      benchFrames = std::atoi(argv[i] + 15);
+    else if (std::strncmp(argv[i], "--bench-report=", 15) == 0)
+      benchReport = argv[i] + 15;
+    else if (std::strcmp(argv[i], "--profile") == 0)
+      profile = true;
+    else if (std::strncmp(argv[i], "--profile=", 10) == 0) {
+      profile = true;
+      profileTrace = argv[i] + 10;
+    }
+  }
+  // the report needs at least one measured frame
+  if (benchFrames < 1 || benchWarmup < 0) {
+    std::fprintf(stderr, "[BENCH] usage: --bench-frames=N with N >= 1, "
+                         "--bench-warmup=N with N >= 0\n");
+    return 1;
+  }
+
+  GLFWwindow *window = nullptr;
+  HeadlessContext offscreen;
+  if (headless) {
+    if (!offscreen.Create(SCR_WIDTH, SCR_HEIGHT))
+      return 1;
+    gladLoadGLLoader((GLADloadproc)HeadlessContext::GetProcAddress);
+    offscreen.CreateFramebuffer();
+  } else {
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "GL 3D Solar System",
+                              NULL, NULL);
+    glfwMakeContextCurrent(window);
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwGetFramebufferSize(window, &viewportWidth, &viewportHeight);
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetMouseButtonCallback(window, mouse_button_callback);
+    gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    // measure rendering, not the display's refresh rate
+    if (benchMode)
+      glfwSwapInterval(0);
+  }
+
+  GLStateCache::Instance().Enable(GL_DEPTH_TEST);
+  // before the shaders, so their compiles are timed too
+  if (profile)
+    Profiler::Instance().Enable(!profileTrace.empty());
+
+  std::string defines = sphereShaderDefines(vertexFormat);
+  const char *vertexPath = "resources/shaders/vertex.glsl";
+  const char *fragmentPath = "resources/shaders/fragment.glsl";
+  if (gpuOrbits || instanced) {
+    vertexPath = gpuOrbits ? "resources/shaders/vertex_orbit.glsl"
+                           : "resources/shaders/vertex_instanced.glsl";
+    fragmentPath = "resources/shaders/fragment_instanced.glsl";
+  }
+  Shader shader(vertexPath, fragmentPath, defines);
 
+  SphereLODSet spheres(vertexFormat);
+
+  JobSystem jobs;
   Scene scene;
+  if (!scenePath.empty())
+    scene.Load(scenePath);
+  if (gpuOrbits)
+    scene.InitGPUOrbits(spheres);
+  else if (instanced)
+    scene.InitInstancing(spheres);
 
   glm::mat4 projection =
       glm::perspective(glm::radians(45.0f), 1280.0f / 720.0f, 0.1f, 100.0f);
-  while (!glfwWindowShouldClose(window)) {
-    float time = glfwGetTime();
+  FrameUniforms frameUniforms;
+  shader.bindUniformBlock("FrameUniforms", FrameUniforms::BINDING);
+  float lastStatsTime = 0.0f;
+  std::unique_ptr<FrameBench> bench;
+  if (benchMode)
+    bench.reset(new FrameBench(benchWarmup, benchFrames));
+  for (long frameCount = 0;
+       bench      ? !bench->Done()
+       : headless ? frameCount < frameLimit
+                  : !glfwWindowShouldClose(window);
+       ++frameCount) {
+    // benchmarks run on simulated time so every run draws the same frames
+    float time = bench      ? (float)bench->Time()
+                 : headless ? (float)offscreen.GetTime()
+                            : (float)glfwGetTime();
     deltaTime = time - lastFrame;
     lastFrame = time;
 
-    processInput(window);
-    scene.Update(time);
+    // the camera stays put while benchmarking
+    if (!headless && !bench)
+      processInput(window);
+    if (bench)
+      bench->BeginFrame();
+    GLStateCache::Instance().BeginFrame();
+    Profiler::Instance().BeginFrame();
+    // with GPU orbits the CPU positions are only needed for picking and
+    // the nearest-body readout
+    bool statsDue = !bench && time - lastStatsTime >= 1.0f;
+    if (!gpuOrbits || pickRequested || statsDue)
+      scene.Update(time, &jobs);
 
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    shader.use();
-    shader.setMat4("view", camera.GetViewMatrix());
-    shader.setMat4(
-        "projection",
-        glm::perspective(glm::radians(45.0f), 1280.f / 720.f, 0.1f, 100.0f));
+    // camera, light and view position for every program in one write
+    FrameData frame;
+    frame.view = camera.GetViewMatrix();
+    frame.projection = projection;
+    frame.viewPos = glm::vec4(camera.Position, 1.0f);
+    frame.lightPos = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    frame.lightColor = glm::vec4(1.0f);
+    frameUniforms.Update(frame);
+
+    RenderView renderView;
+    renderView.view = frame.view;
+    renderView.projection = projection;
+    renderView.cameraPos = camera.Position;
+    renderView.viewportWidth = (float)viewportWidth;
+    renderView.viewportHeight = (float)viewportHeight;
+
+    // the cursor is captured by the camera, so clicks pick through the
+    // center of the view
+    if (pickRequested) {
+      glm::vec3 dir = ViewRayDirection(renderView, 0.5f * viewportWidth,
+                                       0.5f * viewportHeight);
+      int body = scene.Pick(camera.Position, dir);
+      if (body >= 0)
+        std::printf("Picked body %d\n", body);
+      pickRequested = false;
+    }
 
     shader.use();
-    shader.setMat4("projection", projection);
-    shader.setMat4("view", camera.GetViewMatrix());
+    if (gpuOrbits)
+      scene.RenderGPUOrbits(shader, spheres, time);
+    else if (instanced)
+      scene.RenderInstanced(spheres, renderView);
+    else
+      scene.Render(shader, spheres, renderView);
 
-    // Set light and view position
-    shader.setVec3("lightPos", glm::vec3(0.0f));
-    shader.setVec3("viewPos", camera.Position);
-    shader.setVec3("lightColor", glm::vec3(1.0f));
-    scene.Render(shader, VAO);
+    // report the culling counters, the body nearest the camera, how often
+    // the instance stream had to wait for the GPU and how many redundant
+    // GL state calls were skipped, once a second
+    if (statsDue) {
+      const CullStats &stats = scene.GetCullStats();
+      RingWaitStats waits = scene.TakeStreamWaitStats();
+      const GLStateStats &glCalls = GLStateCache::Instance().LastFrame();
+      float distance;
+      int nearest = scene.NearestBody(camera.Position, distance);
+      char title[256];
+      std::snprintf(title, sizeof(title),
+                    "GL 3D Solar System - %zu visible, %zu culled, "
+                    "nearest body %d at %.1f, stalled %u/%u frames "
+                    "(max %.2f ms), state calls %u issued/%u elided",
+                    stats.visible, stats.culled, nearest, distance,
+                    waits.stalledFrames, waits.frames, waits.maxMs,
+                    glCalls.issued, glCalls.elided);
+      if (headless)
+        std::printf("%s\n", title);
+      else
+        glfwSetWindowTitle(window, title);
+      // totals of the frame whose GPU queries were collected last
+      for (const ProfileScopeStats &scope : Profiler::Instance().LastFrame())
+        std::printf("%-24s cpu %7.3f ms  gpu %7.3f ms  x%u\n", scope.name,
+                    scope.cpuMs, scope.gpuMs, scope.calls);
+      lastStatsTime = time;
+    }
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    if (bench)
+      bench->EndFrame();
+    if (headless) {
+      offscreen.EndFrame();
+    } else {
+      glfwSwapBuffers(window);
+      glfwPollEvents();
+    }
   }
-  glfwTerminate();
+  if (bench) {
+    if (bench->WriteReport(benchReport, "SolarSystem"))
+      std::printf("Benchmark report written to %s\n", benchReport.c_str());
+    bench.reset();
+  }
+  if (profile) {
+    if (!profileTrace.empty() &&
+        Profiler::Instance().WriteTrace(profileTrace))
+      std::printf("Profiler trace written to %s\n", profileTrace.c_str());
+    Profiler::Instance().Destroy();
+  }
+  scene.Destroy();
+  spheres.Destroy();
+  if (headless)
+    offscreen.Destroy();
+  else
+    glfwTerminate();
   return 0;
 }
 
@@ -94,6 +287,12 @@ void mouse_callback(GLFWwindow *window, double xpos, double ypos) {
   lastY = ypos;
   camera.ProcessMouseMovement(xoffset, yoffset);
 }
+void mouse_button_callback(GLFWwindow *, int button, int action, int) {
+  if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
+    pickRequested = true;
+}
 void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
   glViewport(0, 0, width, height);
+  viewportWidth = width;
+  viewportHeight = height;
 }
@@ -0,0 +1,36 @@
+#version 330 core
+in vec3 FragPos;
+in vec3 Normal;
+in vec3 ObjectColor;
+
+layout(std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 lightPos;
+    vec4 lightColor;
+};
+
+out vec4 FragColor;
+
+void main() {
+    // Ambient
+    float ambientStrength = 0.1;
+    vec3 ambient = ambientStrength * lightColor.rgb;
+
+    // Diffuse
+    vec3 norm = normalize(Normal);
+    vec3 lightDir = normalize(lightPos.xyz - FragPos);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = diff * lightColor.rgb;
+
+    // Specular
+    float specularStrength = 0.5;
+    vec3 viewDir = normalize(viewPos.xyz - FragPos);
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32); // shininess = 32
+    vec3 specular = specularStrength * spec * lightColor.rgb;
+
+    vec3 result = (ambient + diffuse + specular) * ObjectColor;
+    FragColor = vec4(result, 1.0);
+}
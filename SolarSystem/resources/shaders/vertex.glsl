@@ -1,17 +1,43 @@
 #version 330 core
 layout(location = 0) in vec3 aPos;
-layout(location = 1) in vec3 aNormal;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+layout(std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 lightPos;
+    vec4 lightColor;
+};
 
 out vec3 FragPos;
 out vec3 Normal;
 
+#if defined(SPHERE_OCTAHEDRAL_NORMAL)
+layout(location = 1) in vec2 aNormalOct;
+
+vec3 sphereNormal() {
+    vec3 n = vec3(aNormalOct, 1.0 - abs(aNormalOct.x) - abs(aNormalOct.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+#elif defined(SPHERE_NORMAL_FROM_POSITION)
+// on a unit sphere the normal is the position
+vec3 sphereNormal() { return aPos; }
+#else
+layout(location = 1) in vec3 aNormal;
+
+vec3 sphereNormal() { return aNormal; }
+#endif
+
 void main() {
     vec4 worldPos = model * vec4(aPos, 1.0);
     FragPos = vec3(worldPos);
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    // bodies are only translated and uniformly scaled, which leaves normal
+    // directions unchanged, so no normal matrix is needed
+    Normal = sphereNormal();
     gl_Position = projection * view * worldPos;
 }
@@ -0,0 +1,45 @@
+#version 330 core
+layout(location = 0) in vec3 aPos;
+layout(location = 2) in vec3 aOffset;
+layout(location = 3) in float aScale;
+layout(location = 4) in vec3 aColor;
+
+layout(std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 lightPos;
+    vec4 lightColor;
+};
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec3 ObjectColor;
+
+#if defined(SPHERE_OCTAHEDRAL_NORMAL)
+layout(location = 1) in vec2 aNormalOct;
+
+vec3 sphereNormal() {
+    vec3 n = vec3(aNormalOct, 1.0 - abs(aNormalOct.x) - abs(aNormalOct.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+#elif defined(SPHERE_NORMAL_FROM_POSITION)
+// on a unit sphere the normal is the position
+vec3 sphereNormal() { return aPos; }
+#else
+layout(location = 1) in vec3 aNormal;
+
+vec3 sphereNormal() { return aNormal; }
+#endif
+
+void main() {
+    vec4 worldPos = vec4(aOffset + aPos * aScale, 1.0);
+    FragPos = vec3(worldPos);
+    // translation and uniform scale leave normal directions unchanged
+    Normal = sphereNormal();
+    ObjectColor = aColor;
+    gl_Position = projection * view * worldPos;
+}
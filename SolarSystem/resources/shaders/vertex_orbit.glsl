@@ -0,0 +1,51 @@
+#version 330 core
+layout(location = 0) in vec3 aPos;
+// orbit radius and angular speed; the position is derived from time
+layout(location = 2) in vec2 aOrbit;
+layout(location = 3) in float aScale;
+layout(location = 4) in vec3 aColor;
+
+uniform float time;
+
+layout(std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 lightPos;
+    vec4 lightColor;
+};
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec3 ObjectColor;
+
+#if defined(SPHERE_OCTAHEDRAL_NORMAL)
+layout(location = 1) in vec2 aNormalOct;
+
+vec3 sphereNormal() {
+    vec3 n = vec3(aNormalOct, 1.0 - abs(aNormalOct.x) - abs(aNormalOct.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+#elif defined(SPHERE_NORMAL_FROM_POSITION)
+// on a unit sphere the normal is the position
+vec3 sphereNormal() { return aPos; }
+#else
+layout(location = 1) in vec3 aNormal;
+
+vec3 sphereNormal() { return aNormal; }
+#endif
+
+void main() {
+    // same circular orbit as UpdateOrbits on the CPU
+    float angle = aOrbit.y * time;
+    vec3 offset = aOrbit.x * vec3(cos(angle), 0.0, sin(angle));
+    vec4 worldPos = vec4(offset + aPos * aScale, 1.0);
+    FragPos = vec3(worldPos);
+    // translation and uniform scale leave normal directions unchanged
+    Normal = sphereNormal();
+    ObjectColor = aColor;
+    gl_Position = projection * view * worldPos;
+}
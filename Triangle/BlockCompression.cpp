@@ -0,0 +1,315 @@
+#include "BlockCompression.h"
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+const size_t BC1_BLOCK_BYTES = 8;
+const size_t BC3_BLOCK_BYTES = 16;
+
+int BlocksAcross(int pixels) { return pixels > 0 ? (pixels + 3) / 4 : 1; }
+
+uint16_t PackRGB565(const float rgb[3]) {
+  int r = (int)(rgb[0] * 31.0f / 255.0f + 0.5f);
+  int g = (int)(rgb[1] * 63.0f / 255.0f + 0.5f);
+  int b = (int)(rgb[2] * 31.0f / 255.0f + 0.5f);
+  r = r < 0 ? 0 : r > 31 ? 31 : r;
+  g = g < 0 ? 0 : g > 63 ? 63 : g;
+  b = b < 0 ? 0 : b > 31 ? 31 : b;
+  return (uint16_t)(r << 11 | g << 5 | b);
+}
+
+// Expands to 8 bits per channel by replicating the high bits, as the GPU
+// does.
+void UnpackRGB565(uint16_t c, int rgb[3]) {
+  int r = c >> 11 & 31, g = c >> 5 & 63, b = c & 31;
+  rgb[0] = r << 3 | r >> 2;
+  rgb[1] = g << 2 | g >> 4;
+  rgb[2] = b << 3 | b >> 2;
+}
+
+// The four colors of a 4-color-mode BC1 block.
+void ColorPalette(uint16_t c0, uint16_t c1, int palette[4][3]) {
+  UnpackRGB565(c0, palette[0]);
+  UnpackRGB565(c1, palette[1]);
+  for (int c = 0; c < 3; ++c) {
+    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+  }
+}
+
+// Index of the palette entry nearest to each pixel; returns the total
+// squared error.
+int ChooseColorIndices(const unsigned char block[64], uint16_t c0,
+                        uint16_t c1, int indices[16]) {
+  int palette[4][3];
+  ColorPalette(c0, c1, palette);
+  int total = 0;
+  for (int i = 0; i < 16; ++i) {
+    int best = 0, bestError = 1 << 30;
+    for (int p = 0; p < 4; ++p) {
+      int error = 0;
+      for (int c = 0; c < 3; ++c) {
+        int d = block[i * 4 + c] - palette[p][c];
+        error += d * d;
+      }
+      if (error < bestError) {
+        best = p;
+        bestError = error;
+      }
+    }
+    indices[i] = best;
+    total += bestError;
+  }
+  return total;
+}
+
+// Endpoints that best fit the given indices in the least-squares sense.
+// Returns false if every pixel uses the same weight.
+bool RefitEndpoints(const unsigned char block[64], const int indices[16],
+                    float e0[3], float e1[3]) {
+  static const float WEIGHT[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+  float aa = 0, bb = 0, ab = 0, ax[3] = {}, bx[3] = {};
+  for (int i = 0; i < 16; ++i) {
+    float a = WEIGHT[indices[i]], b = 1.0f - a;
+    aa += a * a;
+    bb += b * b;
+    ab += a * b;
+    for (int c = 0; c < 3; ++c) {
+      ax[c] += a * block[i * 4 + c];
+      bx[c] += b * block[i * 4 + c];
+    }
+  }
+  float det = aa * bb - ab * ab;
+  if (det < 1e-6f)
+    return false;
+  for (int c = 0; c < 3; ++c) {
+    e0[c] = (ax[c] * bb - bx[c] * ab) / det;
+    e1[c] = (bx[c] * aa - ax[c] * ab) / det;
+  }
+  return true;
+}
+
+// Writes the color half of a block in 4-color mode. Endpoints come from
+// the extremes along the principal axis of the pixels' colors, followed
+// by one least-squares refinement that is kept if it lowers the error.
+void EncodeColorBlock(const unsigned char block[64], unsigned char out[8]) {
+  float mean[3] = {};
+  for (int i = 0; i < 16; ++i)
+    for (int c = 0; c < 3; ++c)
+      mean[c] += block[i * 4 + c] / 16.0f;
+  float cov[6] = {}; // rr rg rb gg gb bb
+  for (int i = 0; i < 16; ++i) {
+    float d[3];
+    for (int c = 0; c < 3; ++c)
+      d[c] = block[i * 4 + c] - mean[c];
+    cov[0] += d[0] * d[0];
+    cov[1] += d[0] * d[1];
+    cov[2] += d[0] * d[2];
+    cov[3] += d[1] * d[1];
+    cov[4] += d[1] * d[2];
+    cov[5] += d[2] * d[2];
+  }
+  // power iteration for the principal axis
+  float axis[3] = {1.0f, 1.0f, 1.0f};
+  for (int iteration = 0; iteration < 8; ++iteration) {
+    float next[3] = {cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+                     cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+                     cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]};
+    float largest = next[0];
+    for (int c = 1; c < 3; ++c)
+      if (next[c] * next[c] > largest * largest)
+        largest = next[c];
+    if (largest * largest < 1e-12f)
+      break;
+    for (int c = 0; c < 3; ++c)
+      axis[c] = next[c] / largest;
+  }
+  float lo = 0.0f, hi = 0.0f;
+  for (int i = 0; i < 16; ++i) {
+    float t = 0.0f;
+    for (int c = 0; c < 3; ++c)
+      t += (block[i * 4 + c] - mean[c]) * axis[c];
+    lo = t < lo ? t : lo;
+    hi = t > hi ? t : hi;
+  }
+  float length = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+  float e0[3], e1[3];
+  for (int c = 0; c < 3; ++c) {
+    e0[c] = mean[c] + axis[c] * hi / length;
+    e1[c] = mean[c] + axis[c] * lo / length;
+  }
+
+  uint16_t c0 = PackRGB565(e0), c1 = PackRGB565(e1);
+  int indices[16];
+  int error = ChooseColorIndices(block, c0, c1, indices);
+  if (RefitEndpoints(block, indices, e0, e1)) {
+    uint16_t r0 = PackRGB565(e0), r1 = PackRGB565(e1);
+    int refitIndices[16];
+    int refitError = ChooseColorIndices(block, r0, r1, refitIndices);
+    if (refitError < error) {
+      c0 = r0;
+      c1 = r1;
+      std::memcpy(indices, refitIndices, sizeof(indices));
+    }
+  }
+
+  // 4-color mode needs c0 > c1; when equal every entry is c0 anyway
+  if (c0 < c1) {
+    uint16_t t = c0;
+    c0 = c1;
+    c1 = t;
+    for (int i = 0; i < 16; ++i)
+      indices[i] ^= 1;
+  } else if (c0 == c1) {
+    for (int i = 0; i < 16; ++i)
+      indices[i] = 0;
+  }
+  uint32_t bits = 0;
+  for (int i = 0; i < 16; ++i)
+    bits |= (uint32_t)indices[i] << (2 * i);
+  out[0] = (unsigned char)(c0 & 0xff);
+  out[1] = (unsigned char)(c0 >> 8);
+  out[2] = (unsigned char)(c1 & 0xff);
+  out[3] = (unsigned char)(c1 >> 8);
+  for (int b = 0; b < 4; ++b)
+    out[4 + b] = (unsigned char)(bits >> (8 * b));
+}
+
+// The eight alphas of a BC3 block with a0 > a1, or six plus 0 and 255
+// otherwise.
+void AlphaPalette(int a0, int a1, int palette[8]) {
+  palette[0] = a0;
+  palette[1] = a1;
+  if (a0 > a1) {
+    for (int i = 1; i < 7; ++i)
+      palette[1 + i] = ((7 - i) * a0 + i * a1) / 7;
+  } else {
+    for (int i = 1; i < 5; ++i)
+      palette[1 + i] = ((5 - i) * a0 + i * a1) / 5;
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+}
+
+void EncodeAlphaBlock(const unsigned char block[64], unsigned char out[8]) {
+  int lo = 255, hi = 0;
+  for (int i = 0; i < 16; ++i) {
+    int a = block[i * 4 + 3];
+    lo = a < lo ? a : lo;
+    hi = a > hi ? a : hi;
+  }
+  // hi == lo selects the six-alpha mode, whose index 0 is still hi
+  int palette[8];
+  AlphaPalette(hi, lo, palette);
+  uint64_t bits = 0;
+  for (int i = 0; i < 16; ++i) {
+    int a = block[i * 4 + 3], best = 0, bestError = 256;
+    for (int p = 0; p < 8; ++p) {
+      int error = a > palette[p] ? a - palette[p] : palette[p] - a;
+      if (error < bestError) {
+        best = p;
+        bestError = error;
+      }
+    }
+    bits |= (uint64_t)best << (3 * i);
+  }
+  out[0] = (unsigned char)hi;
+  out[1] = (unsigned char)lo;
+  for (int b = 0; b < 6; ++b)
+    out[2 + b] = (unsigned char)(bits >> (8 * b));
+}
+
+void DecodeColorBlock(const unsigned char in[8], bool allowThreeColor,
+                       unsigned char block[64]) {
+  uint16_t c0 = (uint16_t)(in[0] | in[1] << 8);
+  uint16_t c1 = (uint16_t)(in[2] | in[3] << 8);
+  int palette[4][3];
+  ColorPalette(c0, c1, palette);
+  bool threeColor = allowThreeColor && c0 <= c1;
+  if (threeColor)
+    for (int c = 0; c < 3; ++c) {
+      palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+      palette[3][c] = 0;
+    }
+  uint32_t bits = (uint32_t)(in[4] | in[5] << 8 | in[6] << 16) |
+                  (uint32_t)in[7] << 24;
+  for (int i = 0; i < 16; ++i) {
+    int index = bits >> (2 * i) & 3;
+    for (int c = 0; c < 3; ++c)
+      block[i * 4 + c] = (unsigned char)palette[index][c];
+    block[i * 4 + 3] = threeColor && index == 3 ? 0 : 255;
+  }
+}
+
+void DecodeAlphaBlock(const unsigned char in[8], unsigned char block[64]) {
+  int palette[8];
+  AlphaPalette(in[0], in[1], palette);
+  uint64_t bits = 0;
+  for (int b = 0; b < 6; ++b)
+    bits |= (uint64_t)in[2 + b] << (8 * b);
+  for (int i = 0; i < 16; ++i)
+    block[i * 4 + 3] = (unsigned char)palette[bits >> (3 * i) & 7];
+}
+
+} // namespace
+
+size_t BlockBytes(BlockFormat format) {
+  return format == BLOCK_BC3 ? BC3_BLOCK_BYTES : BC1_BLOCK_BYTES;
+}
+
+size_t BlockCompressedSize(int width, int height, BlockFormat format) {
+  return (size_t)BlocksAcross(width) * BlocksAcross(height) *
+         BlockBytes(format);
+}
+
+void EncodeBlockRows(const unsigned char *rgba, int width, int height,
+                     BlockFormat format, int firstBlockRow, int endBlockRow,
+                     unsigned char *out) {
+  int blocksAcross = BlocksAcross(width);
+  size_t blockBytes = BlockBytes(format);
+  for (int by = firstBlockRow; by < endBlockRow; ++by) {
+    for (int bx = 0; bx < blocksAcross; ++bx) {
+      // gather the block, repeating the last row and column past the edge
+      unsigned char block[64];
+      for (int y = 0; y < 4; ++y) {
+        int sy = by * 4 + y < height ? by * 4 + y : height - 1;
+        for (int x = 0; x < 4; ++x) {
+          int sx = bx * 4 + x < width ? bx * 4 + x : width - 1;
+          std::memcpy(&block[(y * 4 + x) * 4],
+                      &rgba[((size_t)sy * width + sx) * 4], 4);
+        }
+      }
+      unsigned char *dst =
+          out + ((size_t)by * blocksAcross + bx) * blockBytes;
+      if (format == BLOCK_BC3) {
+        EncodeAlphaBlock(block, dst);
+        dst += 8;
+      }
+      EncodeColorBlock(block, dst);
+    }
+  }
+}
+
+void DecodeBlockImage(const unsigned char *blocks, int width, int height,
+                      BlockFormat format, unsigned char *rgba) {
+  int blocksAcross = BlocksAcross(width);
+  size_t blockBytes = BlockBytes(format);
+  for (int by = 0; by < BlocksAcross(height); ++by) {
+    for (int bx = 0; bx < blocksAcross; ++bx) {
+      const unsigned char *src =
+          blocks + ((size_t)by * blocksAcross + bx) * blockBytes;
+      unsigned char block[64];
+      if (format == BLOCK_BC3) {
+        DecodeColorBlock(src + 8, false, block);
+        DecodeAlphaBlock(src, block);
+      } else {
+        DecodeColorBlock(src, true, block);
+      }
+      for (int y = 0; y < 4 && by * 4 + y < height; ++y)
+        for (int x = 0; x < 4 && bx * 4 + x < width; ++x)
+          std::memcpy(&rgba[((size_t)(by * 4 + y) * width + bx * 4 + x) * 4],
+                      &block[(y * 4 + x) * 4], 4);
+    }
+  }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+
+// BC1 and BC3 (S3TC / DXT1 and DXT5) block compression. Images are split
+// into 4x4 pixel blocks; BC1 stores each block's colors in 8 bytes, BC3
+// adds 8 bytes of interpolated alpha. Compared with RGBA8 that is 8x and
+// 4x less memory and sampling bandwidth.
+//
+// The encoder is meant for offline use (tools/texcook). The decoder is the
+// runtime fallback for drivers without GL_EXT_texture_compression_s3tc.
+enum BlockFormat {
+  BLOCK_BC1, // opaque RGB
+  BLOCK_BC3, // RGBA
+};
+
+size_t BlockBytes(BlockFormat format);
+
+// Bytes of a width x height image; partial blocks at the right and bottom
+// edges count as whole ones.
+size_t BlockCompressedSize(int width, int height, BlockFormat format);
+
+// Encodes the block rows [firstBlockRow, endBlockRow) of a tightly packed
+// RGBA8 image into out, which points at the start of the whole image's
+// blocks. Separate row ranges can be encoded on separate threads.
+void EncodeBlockRows(const unsigned char *rgba, int width, int height,
+                     BlockFormat format, int firstBlockRow, int endBlockRow,
+                     unsigned char *out);
+
+// Decodes a whole image to tightly packed RGBA8.
+void DecodeBlockImage(const unsigned char *blocks, int width, int height,
+                      BlockFormat format, unsigned char *rgba);
@@ -0,0 +1,47 @@
+#include "CommandBucket.h"
+#include <cstring>
+
+uint64_t MakeSortKey(unsigned int program, unsigned int material,
+                     unsigned int vao, float viewDepth) {
+  // the bit pattern of a non-negative float increases with its value, so
+  // its top 24 bits are an order-preserving depth quantization
+  if (!(viewDepth > 0.0f))
+    viewDepth = 0.0f;
+  uint32_t depthBits;
+  std::memcpy(&depthBits, &viewDepth, sizeof(depthBits));
+
+  return (uint64_t)(program & 0x3FFu) << 54 |
+         (uint64_t)(material & 0x3FFFu) << 40 |
+         (uint64_t)(vao & 0xFFFFu) << 24 | (uint64_t)(depthBits >> 8);
+}
+
+void RadixSortKeys(std::vector<SortEntry> &entries,
+                   std::vector<SortEntry> &scratch) {
+  size_t count = entries.size();
+  if (count < 2)
+    return;
+  scratch.resize(count);
+
+  // bits that differ between at least two keys
+  uint64_t varying = 0;
+  for (const SortEntry &entry : entries)
+    varying |= entry.key ^ entries[0].key;
+
+  for (int shift = 0; shift < 64; shift += 8) {
+    if (((varying >> shift) & 0xFF) == 0)
+      continue;
+
+    size_t offsets[256] = {};
+    for (const SortEntry &entry : entries)
+      ++offsets[(entry.key >> shift) & 0xFF];
+    size_t sum = 0;
+    for (size_t &offset : offsets) {
+      size_t n = offset;
+      offset = sum;
+      sum += n;
+    }
+    for (const SortEntry &entry : entries)
+      scratch[offsets[(entry.key >> shift) & 0xFF]++] = entry;
+    entries.swap(scratch);
+  }
+}
@@ -0,0 +1,47 @@
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#pragma once
+
+// Key layout, most significant first: program (10 bits), material or
+// texture set (14), VAO (16), view depth (24). Sorting by key groups draws
+// by state and orders each group front to back for early-Z. Names wider
+// than their field only weaken the grouping, never the draw itself.
+uint64_t MakeSortKey(unsigned int program, unsigned int material,
+                     unsigned int vao, float viewDepth);
+
+struct SortEntry {
+  uint64_t key;
+  uint32_t index;
+};
+
+// Stable LSD radix sort of entries by key, 8 bits per pass. Passes over
+// bytes that are equal in every key are skipped.
+void RadixSortKeys(std::vector<SortEntry> &entries,
+                   std::vector<SortEntry> &scratch);
+
+// Draw commands recorded in any order and submitted sorted by key.
+template <typename Command> class CommandBucket {
+public:
+  void Clear() {
+    commands.clear();
+    entries.clear();
+  }
+  void Add(uint64_t key, const Command &command) {
+    entries.push_back({key, (uint32_t)commands.size()});
+    commands.push_back(command);
+  }
+  size_t Size() const { return commands.size(); }
+
+  void Sort() { RadixSortKeys(entries, scratch); }
+  // Calls submit(command) for every command in key order.
+  template <typename Fn> void Submit(Fn submit) const {
+    for (const SortEntry &entry : entries)
+      submit(commands[entry.index]);
+  }
+
+private:
+  std::vector<Command> commands;
+  std::vector<SortEntry> entries, scratch;
+};
@@ -0,0 +1,96 @@
+#include "CookedTexture.h"
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool CookedTexture::Open(const std::string &path) {
+  Close();
+#ifdef _WIN32
+  // no mmap; read the file into memory instead
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file)
+    return false;
+  size = (size_t)file.tellg();
+  unsigned char *buffer = new unsigned char[size];
+  file.seekg(0);
+  file.read((char *)buffer, size);
+  data = buffer;
+#else
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  size = (size_t)info.st_size;
+  void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping keeps the file open
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    size = 0;
+    return false;
+  }
+  data = (const unsigned char *)mapped;
+#endif
+
+  header = (const CookedTextureHeader *)data;
+  levels = (const CookedLevelEntry *)(data + sizeof(CookedTextureHeader));
+  const char *problem = nullptr;
+  if (size < sizeof(CookedTextureHeader) ||
+      std::memcmp(header->magic, COOKED_TEXTURE_MAGIC, 4) != 0)
+    problem = "not a cooked texture";
+  else if (header->version != COOKED_TEXTURE_VERSION)
+    problem = "unsupported version";
+  else if (header->levelCount == 0 || header->levelCount > 32 ||
+           size < sizeof(CookedTextureHeader) +
+                      header->levelCount * sizeof(CookedLevelEntry))
+    problem = "bad level table";
+  for (uint32_t i = 0; !problem && i < header->levelCount; ++i)
+    if (levels[i].offset > size || levels[i].size > size - levels[i].offset)
+      problem = "level data out of bounds";
+  if (problem) {
+    std::cout << "Failed to load " << path << ": " << problem << std::endl;
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void CookedTexture::Close() {
+  if (data) {
+#ifdef _WIN32
+    delete[] data;
+#else
+    munmap((void *)data, size);
+#endif
+  }
+  data = nullptr;
+  size = 0;
+  header = nullptr;
+  levels = nullptr;
+}
+
+CookedTexture::Level CookedTexture::GetLevel(int level) const {
+  const CookedLevelEntry &entry = levels[level];
+  return {(int)entry.width, (int)entry.height, data + entry.offset,
+          (size_t)entry.size};
+}
+
+std::string CookedTexturePath(const std::string &imagePath) {
+  size_t dot = imagePath.find_last_of('.');
+  size_t slash = imagePath.find_last_of("/\\");
+  if (dot == std::string::npos ||
+      (slash != std::string::npos && dot < slash))
+    return imagePath + ".ctex";
+  return imagePath.substr(0, dot) + ".ctex";
+}
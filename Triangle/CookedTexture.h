@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Cooked texture files (.ctex), written by tools/texcook. They hold a
+// complete mip chain in a fixed GPU pixel format, so loading one is a
+// memory map plus one upload per level: no image decode and no
+// glGenerateMipmap.
+//
+// Layout, all little-endian; the loader reads it in place:
+//   CookedTextureHeader
+//   CookedLevelEntry[levelCount]     level 0 is the full-size image
+//   level data, each level starting on a COOKED_DATA_ALIGNMENT boundary
+const char COOKED_TEXTURE_MAGIC[4] = {'C', 'T', 'E', 'X'};
+const uint32_t COOKED_TEXTURE_VERSION = 1;
+const size_t COOKED_DATA_ALIGNMENT = 16;
+
+enum CookedFormat : uint32_t {
+  // 8-bit RGBA, rows tightly packed
+  COOKED_RGBA8 = 1,
+  // BC1 / BC3 blocks (BlockCompression.h), row-major by block
+  COOKED_BC1 = 2,
+  COOKED_BC3 = 3,
+};
+
+struct CookedTextureHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t format;
+  uint32_t width, height;
+  uint32_t levelCount;
+  uint32_t reserved[2];
+};
+
+struct CookedLevelEntry {
+  uint64_t offset, size;
+  uint32_t width, height;
+};
+
+static_assert(sizeof(CookedTextureHeader) == 32, "header layout");
+static_assert(sizeof(CookedLevelEntry) == 24, "level entry layout");
+
+// Read-only memory map of a cooked texture file.
+class CookedTexture {
+public:
+  struct Level {
+    int width, height;
+    const unsigned char *data;
+    size_t size;
+  };
+
+  CookedTexture() = default;
+  ~CookedTexture() { Close(); }
+
+  CookedTexture(const CookedTexture &) = delete;
+  CookedTexture &operator=(const CookedTexture &) = delete;
+
+  // Maps the file and validates its header and level table. Returns false
+  // if the file is missing, and also prints the reason if it exists but
+  // is not a usable cooked texture.
+  bool Open(const std::string &path);
+  void Close();
+
+  uint32_t Format() const { return header->format; }
+  int LevelCount() const { return (int)header->levelCount; }
+  Level GetLevel(int level) const;
+
+private:
+  const unsigned char *data = nullptr;
+  size_t size = 0;
+  const CookedTextureHeader *header = nullptr;
+  const CookedLevelEntry *levels = nullptr;
+};
+
+// Path of the cooked file texcook writes for an image: the extension
+// replaced by ".ctex".
+std::string CookedTexturePath(const std::string &imagePath);
@@ -0,0 +1,65 @@
+#include <GL/glew.h>
+#include <unordered_map>
+
+#pragma once
+
+// Calls issued to and skipped by the cache during one frame.
+struct GLStateStats {
+  unsigned int issued = 0;
+  unsigned int elided = 0;
+};
+
+// Shadow copy of the GL binding state of the current context. Each setter
+// compares against the cached value and only calls GL when it changes.
+//
+// The cache is only correct if every bind, enable and delete of the
+// tracked objects goes through it; Invalidate() forgets everything after
+// code that bypasses it. Element array bindings are remembered per VAO,
+// since they are part of the vertex array state.
+class GLStateCache {
+public:
+  static const int MAX_TEXTURE_UNITS = 16;
+
+  // The cache for the one GL context the application renders with.
+  static GLStateCache &Instance();
+
+  void UseProgram(GLuint program);
+  void BindVertexArray(GLuint vao);
+  void BindBuffer(GLenum target, GLuint buffer);
+  // Selects unit with glActiveTexture only if needed.
+  void BindTexture(int unit, GLenum target, GLuint texture);
+  void Enable(GLenum cap);
+  void Disable(GLenum cap);
+
+  // Delete the objects and drop them from the cache, as GL unbinds
+  // deleted names from the current context.
+  void DeleteBuffer(GLuint buffer);
+  void DeleteVertexArray(GLuint vao);
+  void DeleteTexture(GLuint texture);
+
+  void Invalidate();
+
+  // Ends the current frame's counters; LastFrame() then reports them.
+  void BeginFrame();
+  const GLStateStats &LastFrame() const { return lastFrame; }
+
+private:
+  GLStateCache();
+
+  GLuint program;
+  GLuint vao;
+  int activeUnit;
+  // (target, texture) per unit; binding another target on a unit simply
+  // counts as a change
+  GLenum textureTargets[MAX_TEXTURE_UNITS];
+  GLuint textures[MAX_TEXTURE_UNITS];
+  std::unordered_map<GLenum, GLuint> buffers;
+  std::unordered_map<GLuint, GLuint> vaoElementBuffers;
+  std::unordered_map<GLenum, bool> capabilities;
+
+  GLStateStats frame, lastFrame;
+
+  // true if the call must be issued; counts it either way
+  bool Changed(bool changed);
+  void SetCapability(GLenum cap, bool enabled);
+};
@@ -1,4 +1,5 @@
 #include "Mesh.h"
+#include "GLStateCache.h"
 Mesh::Mesh() {
   VAO = 0;
   VBO = 0;
@@ -10,16 +11,17 @@ void Mesh::CreateMesh(GLfloat *vertices, unsigned int *indices,
                       unsigned int numVerts, unsigned int numIdx) {
   indexCount = numIdx;
 
+  GLStateCache &state = GLStateCache::Instance();
   glGenVertexArrays(1, &VAO);
-  glBindVertexArray(VAO);
+  state.BindVertexArray(VAO);
 
   glGenBuffers(1, &IBO);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+  state.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
   glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIdx * sizeof(indices[0]), indices,
                GL_STATIC_DRAW);
 
   glGenBuffers(1, &VBO);
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  state.BindBuffer(GL_ARRAY_BUFFER, VBO);
   glBufferData(GL_ARRAY_BUFFER, numVerts * sizeof(vertices[0]), vertices,
                GL_STATIC_DRAW);
 
@@ -36,24 +38,21 @@ void Mesh::CreateMesh(GLfloat *vertices, unsigned int *indices,
   glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 8,
                         (void *)(sizeof(float) * 5));
   glEnableVertexAttribArray(2);
-
-  glBindVertexArray(0);
 }
 
 void Mesh::RenderMesh() {
-  glBindVertexArray(VAO);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+  // the IBO is part of the VAO state, so binding the VAO is enough; the
+  // state cache leaves it bound for the next draw of the same mesh
+  GLStateCache::Instance().BindVertexArray(VAO);
   glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
-  glBindVertexArray(0);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 Mesh::~Mesh() {
   if (IBO != 0)
-    glDeleteBuffers(1, &IBO);
+    GLStateCache::Instance().DeleteBuffer(IBO);
   if (VBO != 0)
-    glDeleteBuffers(1, &VBO);
+    GLStateCache::Instance().DeleteBuffer(VBO);
   if (VAO != 0)
-    glDeleteVertexArrays(1, &VAO);
+    GLStateCache::Instance().DeleteVertexArray(VAO);
   IBO = 0;
   VBO = 0;
   VAO = 0;
@@ -11,6 +11,8 @@ public:
 
   void RenderMesh();
 
+  GLuint GetVAO() { return VAO; }
+
   ~Mesh();
 
 private:
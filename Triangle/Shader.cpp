@@ -77,6 +77,7 @@ void Shader::compileShaders(const char *vShaderCode, const char *fShaderCode) {
   uniformModel = glGetUniformLocation(shader, "model");
   uniformProjection = glGetUniformLocation(shader, "projection");
   uniformView = glGetUniformLocation(shader, "view");
+  uniformNormalMatrix = glGetUniformLocation(shader, "normalMatrix");
   uniformAmbientColor = glGetUniformLocation(shader, "directionalLight.color");
   uniformAmbientIntensity =
       glGetUniformLocation(shader, "directionalLight.ambientIntensity");
@@ -1,5 +1,7 @@
 #include <GL/glew.h>
 
+#include "GLStateCache.h"
+
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -13,11 +15,14 @@ public:
 
   void CreateFromFiles(const char *vShader, const char *fShader);
 
-  void UseShader() { glUseProgram(this->shader); }
+  void UseShader() { GLStateCache::Instance().UseProgram(this->shader); }
+
+  GLuint GetShaderID() { return this->shader; }
 
   GLuint GetModelLocation() { return this->uniformModel; }
   GLuint GetViewLocation() { return this->uniformView; }
   GLuint GetProjectionLocation() { return this->uniformProjection; }
+  GLuint GetNormalMatrixLocation() { return this->uniformNormalMatrix; }
 
   GLuint GetAmbientIntensityLocation() { return this->uniformAmbientIntensity; }
   GLuint GetAmbientColorLocation() { return this->uniformAmbientColor; }
@@ -27,8 +32,8 @@ public:
 
 private:
   GLuint shader, uniformModel, uniformProjection, uniformView,
-      uniformAmbientIntensity, uniformAmbientColor, uniformDiffuseIntensity,
-      uniformDirection;
+      uniformNormalMatrix, uniformAmbientIntensity, uniformAmbientColor,
+      uniformDiffuseIntensity, uniformDirection;
 
   std::string readShaderCodeFromFile(const char *shaderPath);
   void addShader(GLuint theProgram, const char *shaderCode, GLenum shaderType);
@@ -11,11 +11,12 @@ out vec3 Normal;
 uniform mat4 model;
 uniform mat4 projection;
 uniform mat4 view;
+uniform mat3 normalMatrix;
 
 void main()
 {
     gl_Position = projection * view * model * vec4(pos, 1.0);
     vCol = vec4(clamp(pos, 0.0f, 1.0f), 1.0f);
     TexCoord = tex;
-    Normal = mat3(transpose(inverse(model))) * norm;
+    Normal = normalMatrix * norm;
 }
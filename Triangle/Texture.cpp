@@ -1,5 +1,7 @@
 #include "Texture.h"
+#include "GLStateCache.h"
 #include <iostream>
+#include <utility>
 Texture::Texture() {
   textureID = 0;
   width = 0;
@@ -15,35 +17,55 @@ Texture::Texture(char *(fileLoc)) {
   bitDepth = 0;
   fileLocation = fileLoc;
 }
+Texture::Texture(Texture &&other) noexcept : Texture() {
+  *this = std::move(other);
+}
+Texture &Texture::operator=(Texture &&other) noexcept {
+  std::swap(textureID, other.textureID);
+  std::swap(width, other.width);
+  std::swap(height, other.height);
+  std::swap(bitDepth, other.bitDepth);
+  std::swap(fileLocation, other.fileLocation);
+  std::swap(handle, other.handle);
+  return *this;
+}
 void Texture::LoadTexture() {
   unsigned char *texData =
       stbi_load(fileLocation, &width, &height, &bitDepth, 0);
   if (!texData) {
     std::cout << "Failed to find: " << fileLocation << std::endl;
   }
+  CreateTexture();
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, texData);
+  glGenerateMipmap(GL_TEXTURE_2D);
+  stbi_image_free(texData);
+}
+void Texture::LoadTextureAsync(TextureCache &cache) {
+  handle = cache.Acquire(fileLocation);
+  textureID = handle.Id();
+}
+void Texture::CreateTexture() {
   glGenTextures(1, &textureID);
-  glBindTexture(GL_TEXTURE_2D, textureID);
+  GLStateCache::Instance().BindTexture(0, GL_TEXTURE_2D, textureID);
 
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
-               GL_UNSIGNED_BYTE, texData);
-  glGenerateMipmap(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D, 0);
-  stbi_image_free(texData);
 }
 void Texture::UseTexture() {
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, textureID);
+  GLStateCache::Instance().BindTexture(0, GL_TEXTURE_2D, textureID);
 }
 void Texture::ClearTexture() {
-  glDeleteTextures(1, &textureID);
+  if (handle)
+    handle.Reset();
+  else if (textureID)
+    GLStateCache::Instance().DeleteTexture(textureID);
   textureID = 0;
   width = 0;
   height = 0;
   bitDepth = 0;
   fileLocation = "";
 }
-Texture::~Texture() {}
+Texture::~Texture() { ClearTexture(); }
@@ -1,18 +1,40 @@
 #pragma once
 
+#include "TextureCache.h"
 #include "stb_image.h"
 #include <GL/glew.h>
+
 class Texture {
 public:
   Texture();
   Texture(char *fileLoc);
+  // Textures own their GL storage, so they move rather than copy.
+  Texture(Texture &&other) noexcept;
+  Texture &operator=(Texture &&other) noexcept;
+  Texture(const Texture &) = delete;
+  Texture &operator=(const Texture &) = delete;
+
+  // Creates a texture of its own and loads the file into it right away.
   void LoadTexture();
+  // Takes the file's texture from cache, shared with every other user of
+  // the same file; a new one starts with a placeholder image while the
+  // cache's loader decodes and uploads the file in the background.
+  void LoadTextureAsync(TextureCache &cache);
   void UseTexture();
+  // Deletes the texture if it is this object's own, otherwise hands it
+  // back to the cache.
   void ClearTexture();
+
+  GLuint GetTextureID() { return textureID; }
   ~Texture();
 
 private:
   GLuint textureID;
   int width, height, bitDepth;
   char *fileLocation;
+  // set when the texture comes from a TextureCache
+  TextureHandle handle;
+
+  // Generates textureID, binds it to unit 0 and sets its sampling state.
+  void CreateTexture();
 };
@@ -0,0 +1,149 @@
+#include "TextureCache.h"
+#include "GLStateCache.h"
+#include "TextureLoader.h"
+#include <filesystem>
+#include <utility>
+
+namespace {
+
+// Same file, same string: resolves "." and "..", symlinks and the working
+// directory. Missing files keep the path as given.
+std::string CanonicalPath(const std::string &path) {
+  std::error_code error;
+  std::filesystem::path canonical =
+      std::filesystem::weakly_canonical(path, error);
+  return error ? path : canonical.string();
+}
+
+std::string CacheKey(const std::string &path, const SamplerKey &sampler) {
+  return CanonicalPath(path) + '|' + std::to_string(sampler.wrapS) + ',' +
+         std::to_string(sampler.wrapT) + ',' +
+         std::to_string(sampler.minFilter) + ',' +
+         std::to_string(sampler.magFilter);
+}
+
+} // namespace
+
+TextureHandle::TextureHandle(TextureCache *cache, size_t slot)
+    : cache(cache), slot(slot) {
+  cache->AddReference(slot);
+}
+
+TextureHandle::TextureHandle(const TextureHandle &other)
+    : cache(other.cache), slot(other.slot) {
+  if (cache)
+    cache->AddReference(slot);
+}
+
+TextureHandle::TextureHandle(TextureHandle &&other) noexcept
+    : cache(other.cache), slot(other.slot) {
+  other.cache = nullptr;
+}
+
+TextureHandle &TextureHandle::operator=(TextureHandle other) noexcept {
+  std::swap(cache, other.cache);
+  std::swap(slot, other.slot);
+  return *this;
+}
+
+GLuint TextureHandle::Id() const {
+  return cache ? cache->entries[slot].texture : 0;
+}
+
+void TextureHandle::Reset() {
+  if (cache)
+    cache->Release(slot);
+  cache = nullptr;
+}
+
+TextureCache::TextureCache(TextureLoader &loader, size_t budgetBytes)
+    : loader(loader), budget(budgetBytes) {}
+
+TextureHandle TextureCache::Acquire(const std::string &path,
+                                    const SamplerKey &sampler) {
+  std::string key = CacheKey(path, sampler);
+  auto found = lookup.find(key);
+  if (found != lookup.end())
+    return TextureHandle(this, found->second);
+
+  size_t slot;
+  if (!freeSlots.empty()) {
+    slot = freeSlots.back();
+    freeSlots.pop_back();
+  } else {
+    slot = entries.size();
+    entries.emplace_back();
+  }
+  Entry &entry = entries[slot];
+  entry.key = key;
+  glGenTextures(1, &entry.texture);
+  GLStateCache::Instance().BindTexture(0, GL_TEXTURE_2D, entry.texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sampler.wrapS);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, sampler.wrapT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, sampler.minFilter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampler.magFilter);
+  entry.bytes = loader.Load(entry.texture, path);
+  lookup[key] = slot;
+  residentBytes += entry.bytes;
+
+  TextureHandle handle(this, slot);
+  // make room for the new texture among the unreferenced ones
+  Trim();
+  return handle;
+}
+
+void TextureCache::SetBudget(size_t bytes) {
+  budget = bytes;
+  Trim();
+}
+
+void TextureCache::Trim() {
+  while (residentBytes > budget) {
+    // few distinct textures are resident, so a scan beats keeping a list
+    size_t oldest = entries.size();
+    for (size_t i = 0; i < entries.size(); ++i)
+      if (!entries[i].key.empty() && entries[i].references == 0 &&
+          !loader.IsPending(entries[i].texture) &&
+          (oldest == entries.size() ||
+           entries[i].lastUse < entries[oldest].lastUse))
+        oldest = i;
+    if (oldest == entries.size())
+      return; // everything left is in use or still loading
+    Evict(oldest);
+  }
+}
+
+void TextureCache::Destroy() {
+  for (size_t i = 0; i < entries.size(); ++i)
+    if (!entries[i].key.empty())
+      GLStateCache::Instance().DeleteTexture(entries[i].texture);
+  entries.clear();
+  freeSlots.clear();
+  lookup.clear();
+  residentBytes = 0;
+}
+
+void TextureCache::AddReference(size_t slot) {
+  ++entries[slot].references;
+  entries[slot].lastUse = ++useClock;
+}
+
+void TextureCache::Release(size_t slot) {
+  // handles released after Destroy() find the slot gone
+  if (slot >= entries.size())
+    return;
+  Entry &entry = entries[slot];
+  entry.lastUse = ++useClock;
+  if (--entry.references == 0)
+    Trim();
+}
+
+void TextureCache::Evict(size_t slot) {
+  Entry &entry = entries[slot];
+  GLStateCache::Instance().DeleteTexture(entry.texture);
+  lookup.erase(entry.key);
+  residentBytes -= entry.bytes;
+  ++evictions;
+  entry = Entry();
+  freeSlots.push_back(slot);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class TextureLoader;
+class TextureCache;
+
+// Sampling state of a cached texture. Without sampler objects it lives in
+// the texture itself, so one image with two samplers is two textures.
+struct SamplerKey {
+  GLint wrapS = GL_REPEAT;
+  GLint wrapT = GL_REPEAT;
+  GLint minFilter = GL_LINEAR;
+  GLint magFilter = GL_LINEAR;
+};
+
+// Counted reference to a texture in a TextureCache. Copies share the
+// texture. Once the last reference is gone the texture stays resident,
+// so acquiring it again is free, until the cache needs the memory.
+class TextureHandle {
+public:
+  TextureHandle() = default;
+  TextureHandle(const TextureHandle &other);
+  TextureHandle(TextureHandle &&other) noexcept;
+  TextureHandle &operator=(TextureHandle other) noexcept;
+  ~TextureHandle() { Reset(); }
+
+  // 0 for an empty handle.
+  GLuint Id() const;
+  explicit operator bool() const { return cache != nullptr; }
+  // Drops the reference, leaving the handle empty.
+  void Reset();
+
+private:
+  friend class TextureCache;
+  TextureHandle(TextureCache *cache, size_t slot);
+
+  TextureCache *cache = nullptr;
+  size_t slot = 0;
+};
+
+// Shares one GL texture between every user of the same image file and
+// sampler. Paths are made canonical first, so "Textures/brick.png" and
+// "./Textures/brick.png" are the same texture. New textures are loaded
+// through the TextureLoader.
+//
+// Textures nobody references are deleted least recently used first while
+// the resident total is over the budget. Sizes are the loader's
+// estimates from the file headers, so nothing waits for the GPU.
+//
+// All calls are render-thread only. Handles must not outlive the cache.
+class TextureCache {
+public:
+  static const size_t DEFAULT_BUDGET = 256 << 20;
+
+  explicit TextureCache(TextureLoader &loader,
+                        size_t budgetBytes = DEFAULT_BUDGET);
+  TextureCache(const TextureCache &) = delete;
+  TextureCache &operator=(const TextureCache &) = delete;
+
+  // Returns the cached texture for path and sampler, creating and queuing
+  // it for loading on a miss.
+  TextureHandle Acquire(const std::string &path,
+                        const SamplerKey &sampler = SamplerKey());
+
+  // Evicts straight away if the resident total is over the new budget.
+  void SetBudget(size_t bytes);
+  size_t Budget() const { return budget; }
+  size_t ResidentBytes() const { return residentBytes; }
+  size_t ResidentCount() const { return lookup.size(); }
+  // Evictions since the cache was created.
+  size_t Evictions() const { return evictions; }
+
+  // Evicts unreferenced textures while over budget. Textures still
+  // streaming in are skipped until a later call, since the loader needs
+  // them until their upload completes. Call it once per frame after the
+  // loader's Update.
+  void Trim();
+
+  // Deletes every texture, referenced or not; the context must still be
+  // current. Handles still held afterwards may only be reset or
+  // destroyed.
+  void Destroy();
+
+private:
+  friend class TextureHandle;
+
+  struct Entry {
+    std::string key; // empty for a free slot
+    GLuint texture = 0;
+    size_t bytes = 0;
+    unsigned int references = 0;
+    uint64_t lastUse = 0;
+  };
+
+  TextureLoader &loader;
+  size_t budget;
+  size_t residentBytes = 0;
+  size_t evictions = 0;
+  uint64_t useClock = 0;
+  std::vector<Entry> entries;
+  std::vector<size_t> freeSlots;
+  std::unordered_map<std::string, size_t> lookup;
+
+  void AddReference(size_t slot);
+  void Release(size_t slot);
+  void Evict(size_t slot);
+};
@@ -0,0 +1,452 @@
+#include "TextureLoader.h"
+#include "BlockCompression.h"
+#include "CookedTexture.h"
+#include "GLStateCache.h"
+#include "stb_image.h"
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// Mid grey, so untextured objects are still lit sensibly.
+const unsigned char PLACEHOLDER_PIXEL[4] = {128, 128, 128, 255};
+
+// GL_TEXTURE_MAX_LEVEL's initial value.
+const GLint DEFAULT_MAX_LEVEL = 1000;
+
+GLenum FormatForChannels(int channels) {
+  switch (channels) {
+  case 1:
+    return GL_RED;
+  case 2:
+    return GL_RG;
+  case 3:
+    return GL_RGB;
+  default:
+    return GL_RGBA;
+  }
+}
+
+// Bytes a cooked level of the given format needs.
+size_t CookedLevelSize(uint32_t format, int width, int height) {
+  if (format == COOKED_BC1)
+    return BlockCompressedSize(width, height, BLOCK_BC1);
+  if (format == COOKED_BC3)
+    return BlockCompressedSize(width, height, BLOCK_BC3);
+  return (size_t)width * height * 4;
+}
+
+// Bytes one cooked level takes on the GPU: its blocks as they are, or the
+// RGBA8 pixels they decode to.
+size_t UploadedLevelSize(uint32_t format, bool compressed, int width,
+                         int height) {
+  return compressed ? CookedLevelSize(format, width, height)
+                    : (size_t)width * height * 4;
+}
+
+// Index of the 1x1 level of a full mip chain.
+int LastMipLevel(int width, int height) {
+  int level = 0;
+  for (int size = width > height ? width : height; size > 1; size >>= 1)
+    ++level;
+  return level;
+}
+
+} // namespace
+
+TextureLoader::TextureLoader(unsigned int workerCount) {
+  if (workerCount == 0) {
+    unsigned int hardware = std::thread::hardware_concurrency();
+    workerCount = hardware > 1 ? hardware - 1 : 1;
+  }
+  for (unsigned int i = 0; i < workerCount; ++i)
+    workers.emplace_back(&TextureLoader::WorkerLoop, this);
+}
+
+TextureLoader::~TextureLoader() { StopWorkers(); }
+
+size_t TextureLoader::Load(GLuint texture, const std::string &path) {
+  GLStateCache::Instance().BindTexture(0, GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+               PLACEHOLDER_PIXEL);
+  size_t bytes;
+  bool cooked = QueueCooked(texture, CookedTexturePath(path), bytes);
+  if (!cooked) {
+    int width, height, channels;
+    // RGBA8 plus a third for the mip chain; if the file cannot be read the
+    // placeholder stays
+    bytes = stbi_info(path.c_str(), &width, &height, &channels)
+                ? (size_t)width * height * 4 * 4 / 3
+                : sizeof(PLACEHOLDER_PIXEL);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!cooked)
+      queued.push_back({texture, path, nullptr, 0, 0, 0});
+    ++pending;
+  }
+  inFlight.insert(texture);
+  if (!cooked)
+    wake.notify_one();
+  return bytes;
+}
+
+bool TextureLoader::QueueCooked(GLuint texture,
+                                const std::string &cookedPath,
+                                size_t &bytes) {
+  std::unique_ptr<CookedTexture> cooked(new CookedTexture);
+  if (!cooked->Open(cookedPath))
+    return false;
+  uint32_t format = cooked->Format();
+  if (format != COOKED_RGBA8 && format != COOKED_BC1 &&
+      format != COOKED_BC3) {
+    std::cout << "Unsupported cooked format: " << cookedPath << std::endl;
+    return false;
+  }
+  // Block-compressed levels go to the GPU as they are where S3TC is
+  // available; elsewhere they are decoded and stored uncompressed.
+  bool compressed =
+      format != COOKED_RGBA8 && GLEW_EXT_texture_compression_s3tc;
+  bytes = 0;
+  for (int i = 0; i < cooked->LevelCount(); ++i) {
+    CookedTexture::Level level = cooked->GetLevel(i);
+    if (level.size < CookedLevelSize(format, level.width, level.height)) {
+      std::cout << "Truncated cooked level " << i << ": " << cookedPath
+                << std::endl;
+      return false;
+    }
+    bytes += UploadedLevelSize(format, compressed, level.width, level.height);
+  }
+  int lastLevel = cooked->LevelCount() - 1;
+  cookedUploads.push_back(
+      {texture, std::move(cooked), compressed, lastLevel, 0});
+  return true;
+}
+
+size_t TextureLoader::UploadCookedRows(CookedUpload &upload, size_t room,
+                                       bool first) {
+  uint32_t format = upload.file->Format();
+  int i = upload.nextLevel;
+  CookedTexture::Level level = upload.file->GetLevel(i);
+  BlockFormat blockFormat = format == COOKED_BC1 ? BLOCK_BC1 : BLOCK_BC3;
+  // block-compressed levels go a row of blocks, four pixel rows, at a time
+  int bandRows = format == COOKED_RGBA8 ? 1 : 4;
+  size_t sourceBandBytes =
+      format == COOKED_RGBA8 ? (size_t)level.width * 4
+                             : BlockCompressedSize(level.width, 4, blockFormat);
+  size_t bandBytes = upload.compressed ? sourceBandBytes
+                                       : (size_t)level.width * bandRows * 4;
+  int bandsLeft = (level.height - upload.nextRow + bandRows - 1) / bandRows;
+  size_t fit = room / bandBytes;
+  int bands = fit < (size_t)bandsLeft ? (int)fit : bandsLeft;
+  if (bands == 0) {
+    if (!first)
+      return 0;
+    bands = 1;
+  }
+  int firstRow = upload.nextRow;
+  int rows = firstRow + bands * bandRows < level.height
+                 ? bands * bandRows
+                 : level.height - firstRow;
+  const unsigned char *source =
+      level.data + (size_t)(firstRow / bandRows) * sourceBandBytes;
+  GLenum compressedFormat = format == COOKED_BC1
+                                ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                                : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+  int lastLevel = upload.file->LevelCount() - 1;
+
+  GLStateCache::Instance().BindTexture(0, GL_TEXTURE_2D, upload.texture);
+  if (i == lastLevel && firstRow == 0) {
+    // allocate the whole chain largest first, replacing the placeholder;
+    // Mesa drops some levels that are defined smallest first. texcook
+    // chains end at 1x1, a single band, so the base level gets its pixels
+    // below
+    for (int j = 0; j <= lastLevel; ++j) {
+      CookedTexture::Level other = upload.file->GetLevel(j);
+      if (upload.compressed)
+        glCompressedTexImage2D(
+            GL_TEXTURE_2D, j, compressedFormat, other.width, other.height,
+            0, (GLsizei)CookedLevelSize(format, other.width, other.height),
+            nullptr);
+      else
+        glTexImage2D(GL_TEXTURE_2D, j, GL_RGBA8, other.width, other.height,
+                     0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, lastLevel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, lastLevel);
+  }
+
+  size_t uploaded;
+  if (upload.compressed) {
+    uploaded = bands * sourceBandBytes;
+    glCompressedTexSubImage2D(GL_TEXTURE_2D, i, 0, firstRow, level.width,
+                              rows, compressedFormat, (GLsizei)uploaded,
+                              source);
+  } else {
+    if (format != COOKED_RGBA8) {
+      rgba.resize((size_t)level.width * rows * 4);
+      DecodeBlockImage(source, level.width, rows, blockFormat, rgba.data());
+      source = rgba.data();
+    }
+    uploaded = (size_t)level.width * rows * 4;
+    glTexSubImage2D(GL_TEXTURE_2D, i, 0, firstRow, level.width, rows,
+                    GL_RGBA, GL_UNSIGNED_BYTE, source);
+  }
+
+  upload.nextRow += rows;
+  if (upload.nextRow == level.height) {
+    // every level from here down is complete, so sampling can start here
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, i);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, lastLevel);
+    --upload.nextLevel;
+    upload.nextRow = 0;
+  }
+  return uploaded;
+}
+
+void TextureLoader::WorkerLoop() {
+  for (;;) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [this] { return stopping || !queued.empty(); });
+      if (stopping)
+        return;
+      job = queued.front();
+      queued.pop_front();
+    }
+    job.pixels = stbi_load(job.path.c_str(), &job.width, &job.height,
+                           &job.channels, 0);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      finished.push_back(job);
+    }
+    decoded.notify_all();
+  }
+}
+
+int TextureLoader::Update() { return Pump(uploadBudget); }
+
+void TextureLoader::Finish() {
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      if (pending == 0)
+        return;
+      if (uploads.empty() && cookedUploads.empty() && mipmapQueue.empty())
+        decoded.wait(lock, [this] { return !finished.empty(); });
+    }
+    Pump(0);
+  }
+}
+
+size_t TextureLoader::Pending() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return pending;
+}
+
+bool TextureLoader::IsPending(GLuint texture) const {
+  return inFlight.count(texture) != 0;
+}
+
+TextureStreamStats TextureLoader::TakeStats() {
+  TextureStreamStats stats;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.uploadQueue = finished.size() + uploads.size() +
+                        cookedUploads.size() + mipmapQueue.size();
+    stats.decodeQueue = pending - stats.uploadQueue;
+  }
+  std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+  stats.frames = statsFrames;
+  stats.texturesCompleted = statsCompleted;
+  stats.bytesUploaded = statsBytes;
+  stats.seconds = std::chrono::duration<double>(now - statsStart).count();
+  statsFrames = statsCompleted = 0;
+  statsBytes = 0;
+  statsStart = now;
+  return stats;
+}
+
+int TextureLoader::Pump(size_t budget) {
+  GLStateCache &state = GLStateCache::Instance();
+  ++statsFrames;
+
+  // the last slices of these went out a frame ago, so building the mip
+  // chain no longer waits on the transfer
+  int completed = (int)mipmapQueue.size();
+  for (GLuint texture : mipmapQueue) {
+    state.BindTexture(0, GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, DEFAULT_MAX_LEVEL);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    inFlight.erase(texture);
+  }
+  mipmapQueue.clear();
+
+  std::deque<Job> ready;
+  size_t failed = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ready.swap(finished);
+  }
+  for (Job &job : ready) {
+    if (!job.pixels) {
+      // the placeholder stays
+      std::cout << "Failed to find: " << job.path << std::endl;
+      inFlight.erase(job.texture);
+      ++failed;
+      continue;
+    }
+    GLenum format = FormatForChannels(job.channels);
+    uploads.push_back(
+        {job, format, (size_t)job.width * job.channels, 0});
+  }
+
+  // cooked levels go first, straight from the mapping, smallest level and
+  // oldest texture first; only the first band may exceed the budget
+  size_t cookedBytes = 0;
+  while (!cookedUploads.empty()) {
+    CookedUpload &upload = cookedUploads.front();
+    size_t room = budget ? (cookedBytes < budget ? budget - cookedBytes : 0)
+                         : SIZE_MAX;
+    size_t bytes = UploadCookedRows(upload, room, cookedBytes == 0);
+    if (bytes == 0)
+      break;
+    cookedBytes += bytes;
+    if (upload.nextLevel < 0) {
+      inFlight.erase(upload.texture);
+      cookedUploads.pop_front(); // unmaps the file
+      ++completed;
+    }
+  }
+  statsBytes += cookedBytes;
+
+  // plan the rest of the frame's budget as slices: whole rows, oldest
+  // texture first; only the frame's first upload may exceed the budget,
+  // by less than one row
+  slices.clear();
+  size_t used = 0;
+  for (Upload &upload : uploads) {
+    size_t spent = cookedBytes + used;
+    size_t room = budget ? (spent < budget ? budget - spent : 0) : SIZE_MAX;
+    int remaining = upload.job.height - upload.nextRow;
+    size_t fit = room / upload.rowBytes;
+    int rows = fit < (size_t)remaining ? (int)fit : remaining;
+    if (rows == 0) {
+      if (spent > 0)
+        break;
+      rows = 1;
+    }
+    slices.push_back({&upload, upload.nextRow, rows, used});
+    used += rows * upload.rowBytes;
+    if (budget && cookedBytes + used >= budget)
+      break;
+  }
+
+  if (!slices.empty()) {
+    // level 0 storage is allocated from client memory, before the unpack
+    // buffer is bound
+    for (const Slice &slice : slices)
+      if (slice.firstRow == 0)
+        BeginUpload(*slice.upload);
+
+    // one orphaned unpack buffer holds every slice of this frame; fall back
+    // to client memory if it cannot be mapped
+    if (!unpackBuffer)
+      glGenBuffers(1, &unpackBuffer);
+    state.BindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackBuffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, used, nullptr, GL_STREAM_DRAW);
+    unsigned char *mapped = (unsigned char *)glMapBufferRange(
+        GL_PIXEL_UNPACK_BUFFER, 0, used,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped) {
+      for (const Slice &slice : slices)
+        std::memcpy(mapped + slice.offset,
+                    slice.upload->job.pixels +
+                        slice.firstRow * slice.upload->rowBytes,
+                    slice.rows * slice.upload->rowBytes);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    } else {
+      state.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // rows of 1- and 3-channel images are not 4-byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (const Slice &slice : slices) {
+      Upload &upload = *slice.upload;
+      // with the unpack buffer bound the pointer is an offset into it
+      const void *source =
+          mapped ? (const void *)slice.offset
+                 : upload.job.pixels + slice.firstRow * upload.rowBytes;
+      state.BindTexture(0, GL_TEXTURE_2D, upload.job.texture);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, slice.firstRow, upload.job.width,
+                      slice.rows, upload.format, GL_UNSIGNED_BYTE, source);
+      upload.nextRow += slice.rows;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    // other uploads read from client memory
+    state.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    statsBytes += used;
+  }
+
+  // uploads complete in order, so the finished ones are at the front
+  while (!uploads.empty() &&
+         uploads.front().nextRow == uploads.front().job.height) {
+    stbi_image_free(uploads.front().job.pixels);
+    mipmapQueue.push_back(uploads.front().job.texture);
+    uploads.pop_front();
+  }
+
+  statsCompleted += completed;
+  std::lock_guard<std::mutex> lock(mutex);
+  pending -= completed + failed;
+  return completed;
+}
+
+void TextureLoader::BeginUpload(const Upload &upload) {
+  const Job &job = upload.job;
+  int lastLevel = LastMipLevel(job.width, job.height);
+  GLStateCache::Instance().BindTexture(0, GL_TEXTURE_2D, job.texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, upload.format, job.width, job.height, 0,
+               upload.format, GL_UNSIGNED_BYTE, nullptr);
+  if (lastLevel > 0) {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, lastLevel, upload.format, 1, 1, 0,
+                 upload.format, GL_UNSIGNED_BYTE, PLACEHOLDER_PIXEL);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  }
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, lastLevel);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, lastLevel);
+}
+
+void TextureLoader::StopWorkers() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (std::thread &worker : workers)
+    worker.join();
+  workers.clear();
+  for (Job &job : finished)
+    stbi_image_free(job.pixels);
+  for (Upload &upload : uploads)
+    stbi_image_free(upload.job.pixels);
+  finished.clear();
+  uploads.clear();
+  cookedUploads.clear();
+  queued.clear();
+  mipmapQueue.clear();
+  inFlight.clear();
+  pending = 0;
+}
+
+void TextureLoader::Destroy() {
+  StopWorkers();
+  if (unpackBuffer)
+    GLStateCache::Instance().DeleteBuffer(unpackBuffer);
+  unpackBuffer = 0;
+}
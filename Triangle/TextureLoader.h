@@ -0,0 +1,163 @@
+#pragma once
+
+#include "CookedTexture.h"
+#include <GL/glew.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// Queue depths and upload traffic of a TextureLoader.
+struct TextureStreamStats {
+  // textures waiting for or being decoded
+  size_t decodeQueue = 0;
+  // decoded or cooked textures not yet completely uploaded
+  size_t uploadQueue = 0;
+
+  // since the previous TakeStats call
+  unsigned int frames = 0;
+  unsigned int texturesCompleted = 0;
+  size_t bytesUploaded = 0;
+  double seconds = 0.0;
+
+  double MegabytesPerSecond() const {
+    return seconds > 0.0 ? bytesUploaded / (seconds * 1.0e6) : 0.0;
+  }
+};
+
+// Decodes image files on worker threads and streams them into their
+// textures on the render thread, so image decoding overlaps shader
+// compilation, mesh setup and the first frames.
+//
+// Load() gives the texture a 1x1 placeholder image at once, so it can be
+// bound and drawn with right away. Each Update() then uploads at most the
+// upload budget worth of data, so a large texture arriving mid-session is
+// spread over several frames instead of causing a hitch.
+//
+// If a cooked texture (see CookedTexture.h) lies next to the image, its
+// file stays mapped and Update() uploads rows straight from the mapping,
+// smallest level first. Each completed level becomes the base level, so
+// the texture sharpens as it streams in and needs no glGenerateMipmap.
+//
+// Other images are decoded on the workers and copied row by row through
+// a pixel unpack buffer with glTexSubImage2D. While one streams in, the
+// placeholder sits in its smallest mip level and GL_TEXTURE_BASE_LEVEL
+// points there, so the partly uploaded level 0 is never sampled. One
+// Update after the last slice the full mip chain is generated and the
+// base level is reset. Texture names and bindings never change.
+class TextureLoader {
+public:
+  static const size_t DEFAULT_UPLOAD_BUDGET = 4 << 20;
+
+  // workerCount 0 uses one thread less than the hardware has, at least
+  // one.
+  explicit TextureLoader(unsigned int workerCount = 0);
+  // Stops the workers; call Destroy() first while the context is current.
+  ~TextureLoader();
+
+  TextureLoader(const TextureLoader &) = delete;
+  TextureLoader &operator=(const TextureLoader &) = delete;
+
+  // Bytes copied per Update; 0 means unlimited. At least one row, or one
+  // row of blocks, is uploaded per Update whatever the budget.
+  void SetUploadBudget(size_t bytesPerFrame) { uploadBudget = bytesPerFrame; }
+
+  // Render thread. Binds texture to unit 0, gives it the placeholder and
+  // queues the cooked version of path if there is one, else path itself
+  // for decoding. The texture must not be deleted before its upload
+  // completes. Returns the video memory the texture will take once
+  // complete, estimated from the file headers.
+  size_t Load(GLuint texture, const std::string &path);
+  // Render thread. Uploads the next slices within the budget; returns how
+  // many textures became complete.
+  int Update();
+  // Blocks until every queued texture is complete, ignoring the budget.
+  void Finish();
+  // Textures queued and not yet complete.
+  size_t Pending() const;
+  // Render thread. Whether texture was queued by Load and is not yet
+  // complete; such a texture must not be deleted.
+  bool IsPending(GLuint texture) const;
+  // Current queue depths and the traffic since the previous call.
+  TextureStreamStats TakeStats();
+
+  // Stops the workers and releases the unpack buffer.
+  void Destroy();
+
+private:
+  struct Job {
+    GLuint texture;
+    std::string path;
+    unsigned char *pixels;
+    int width, height, channels;
+  };
+  // A decoded image being copied into its texture.
+  struct Upload {
+    Job job;
+    GLenum format;
+    size_t rowBytes;
+    int nextRow;
+  };
+  // A mapped cooked texture whose levels are being uploaded.
+  struct CookedUpload {
+    GLuint texture;
+    std::unique_ptr<CookedTexture> file;
+    // block-compressed levels go to the GPU as they are
+    bool compressed;
+    // counts down to 0; levels above it are uploaded
+    int nextLevel;
+    // rows of nextLevel uploaded so far
+    int nextRow;
+  };
+  // Rows of one upload copied in the current Update.
+  struct Slice {
+    Upload *upload;
+    int firstRow, rows;
+    size_t offset;
+  };
+
+  std::vector<std::thread> workers;
+  mutable std::mutex mutex;
+  std::condition_variable wake, decoded;
+  std::deque<Job> queued, finished;
+  size_t pending = 0;
+  bool stopping = false;
+
+  // render thread only
+  // textures queued by Load and not yet complete
+  std::unordered_set<GLuint> inFlight;
+  std::deque<Upload> uploads;
+  std::deque<CookedUpload> cookedUploads;
+  // decoded cooked levels where S3TC is unavailable
+  std::vector<unsigned char> rgba;
+  // textures whose last slice went out in the previous Update
+  std::vector<GLuint> mipmapQueue;
+  std::vector<Slice> slices;
+  size_t uploadBudget = DEFAULT_UPLOAD_BUDGET;
+  GLuint unpackBuffer = 0;
+
+  unsigned int statsFrames = 0, statsCompleted = 0;
+  size_t statsBytes = 0;
+  std::chrono::steady_clock::time_point statsStart =
+      std::chrono::steady_clock::now();
+
+  // Maps and validates a cooked file and queues its levels; false if it is
+  // missing or unusable. bytes is set to the video memory it will take.
+  bool QueueCooked(GLuint texture, const std::string &cookedPath,
+                   size_t &bytes);
+  // Uploads the next rows of a cooked texture that fit in room bytes,
+  // block-compressed where the driver supports S3TC and decoded to RGBA8
+  // otherwise, at least one band of rows if first is set. A level becomes
+  // the base level once complete. Returns the bytes uploaded.
+  size_t UploadCookedRows(CookedUpload &upload, size_t room, bool first);
+  void WorkerLoop();
+  void StopWorkers();
+  int Pump(size_t budget);
+  // Allocates level 0 and moves the placeholder to the last mip level.
+  void BeginUpload(const Upload &upload);
+};
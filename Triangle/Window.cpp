@@ -1,4 +1,5 @@
 #include "Window.h"
+#include "GLStateCache.h"
 
 #include <GLFW/glfw3.h>
 Window::Window() {
@@ -55,7 +56,7 @@ int Window::initialize() {
     glfwTerminate();
     return 1;
   }
-  glEnable(GL_DEPTH_TEST);
+  GLStateCache::Instance().Enable(GL_DEPTH_TEST);
   glViewport(0, 0, bufferWidth * 1.5, bufferHeight * 1.5);
 
   glfwSetWindowUserPointer(mainWindow, this);
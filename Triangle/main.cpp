@@ -7,13 +7,21 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
 #include <vector>
 
 #include "Camera.h"
+#include "CommandBucket.h"
+#include "GLStateCache.h"
+#include "Headless.h"
 #include "Light.h"
 #include "Mesh.h"
 #include "Shader.h"
 #include "Texture.h"
+#include "TextureCache.h"
+#include "TextureLoader.h"
 #include "Window.h"
 
 // Constants
@@ -21,6 +29,7 @@ const float toRadians = 3.14159265f / 180.0f;
 float curAngle = 0.0f;
 GLfloat deltaTime{0.0f};
 GLfloat lastTime{0.0f};
+GLfloat lastStatsTime{0.0f};
 
 // scene object creation
 Window mainWindow;
@@ -31,6 +40,14 @@ Texture brickTexture;
 Texture dirtTexture;
 Light mainLight;
 
+// one recorded draw of the main loop
+struct MeshDraw {
+  Mesh *mesh;
+  Texture *texture;
+  glm::mat4 model;
+};
+CommandBucket<MeshDraw> drawBucket;
+
 // shader location define
 static const char *vShader = "Shaders/shader.vert";
 static const char *fShader = "Shaders/shader.frag";
@@ -67,9 +84,62 @@ void CreateShaders() {
   shaderList.push_back(*shader1);
 }
 
-int main() {
+void RecordDraw(Mesh *mesh, Texture *texture, const glm::mat4 &model,
+                const glm::mat4 &view) {
+  // view-space depth of the object's origin
+  float depth = -(view * model[3]).z;
+  uint64_t key = MakeSortKey(shaderList[0].GetShaderID(),
+                             texture->GetTextureID(), mesh->GetVAO(), depth);
+  drawBucket.Add(key, {mesh, texture, model});
+}
+
+int main(int argc, char **argv) {
+  // --headless renders offscreen without a display and exits after
+  // --frames=N frames
+  // --upload-budget=KB caps the texture bytes uploaded per frame (0: none)
+  // --texture-budget=MB is the video memory unused textures may keep
+  bool headless = false;
+  long frameLimit = 300;
+  size_t uploadBudget = TextureLoader::DEFAULT_UPLOAD_BUDGET;
+  size_t textureBudget = TextureCache::DEFAULT_BUDGET;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--headless") == 0)
+      headless = true;
+    else if (std::strncmp(argv[i], "--frames=", 9) == 0)
+      frameLimit = std::atol(argv[i] + 9);
+    else if (std::strncmp(argv[i], "--upload-budget=", 16) == 0)
+      uploadBudget = (size_t)std::atol(argv[i] + 16) * 1024;
+    else if (std::strncmp(argv[i], "--texture-budget=", 17) == 0)
+      textureBudget = (size_t)std::atol(argv[i] + 17) << 20;
+  }
+
   // initialization
-  mainWindow.initialize();
+  HeadlessContext offscreen;
+  GLfloat bufferWidth, bufferHeight;
+  if (headless) {
+    if (!offscreen.Create(800, 600))
+      return 1;
+    offscreen.CreateFramebuffer();
+    GLStateCache::Instance().Enable(GL_DEPTH_TEST);
+    bufferWidth = offscreen.Width();
+    bufferHeight = offscreen.Height();
+  } else {
+    mainWindow.initialize();
+    bufferWidth = mainWindow.getBufferWidth();
+    bufferHeight = mainWindow.getBufferHeight();
+  }
+
+  // texture: queued first so decoding overlaps shader and mesh setup; the
+  // objects draw with a placeholder until their image is uploaded. Objects
+  // using the same file share one texture through the cache
+  TextureLoader textureLoader;
+  textureLoader.SetUploadBudget(uploadBudget);
+  TextureCache textureCache(textureLoader, textureBudget);
+  brickTexture = Texture("Textures/brick.png");
+  brickTexture.LoadTextureAsync(textureCache);
+  dirtTexture = Texture("Textures/dirt.png");
+  dirtTexture.LoadTextureAsync(textureCache);
+
   CreateObjects();
   CreateShaders();
 
@@ -77,12 +147,6 @@ int main() {
   camera = Camera(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
                   -90.0f, 0.0f, 5.0f, 0.5f);
 
-  // texture
-  brickTexture = Texture("Textures/brick.png");
-  brickTexture.LoadTexture();
-  dirtTexture = Texture("Textures/dirt.png");
-  dirtTexture.LoadTexture();
-
   // Light
   mainLight = Light(1.0f, 1.0f, 1.0f,   // RGB
                     0.3f,               // ambientIntensity
@@ -90,27 +154,50 @@ int main() {
                     0.8f);              // diffuseIntensity
 
   GLuint uniformModel{0}, uniformProjection{0}, uniformView{0},
-      uniformAmbientIntensity{0}, uniformAmbientColor{0};
+      uniformNormalMatrix{0}, uniformAmbientIntensity{0},
+      uniformAmbientColor{0}, uniformDiffuseIntensity{0}, uniformDirection{0};
 
   // get perspective right
   glm::mat4 projection =
-      glm::perspective(45.0f,
-                       (GLfloat)mainWindow.getBufferWidth() /
-                           (GLfloat)mainWindow.getBufferHeight(),
-                       0.1f, 100.0f);
+      glm::perspective(45.0f, bufferWidth / bufferHeight, 0.1f, 100.0f);
 
-  // run till window is not closed
-  while (!mainWindow.getShouldClose()) {
+  // run till window is not closed, or for frameLimit frames headless
+  for (long frame = 0;
+       headless ? frame < frameLimit : !mainWindow.getShouldClose();
+       ++frame) {
     // delta time
-    GLfloat now = glfwGetTime();
+    GLfloat now = headless ? offscreen.GetTime() : glfwGetTime();
     deltaTime = now - lastTime;
     lastTime = now;
 
-    glfwPollEvents();
+    if (!headless)
+      glfwPollEvents();
+    GLStateCache::Instance().BeginFrame();
+    textureLoader.Update();
+    textureCache.Trim();
+
+    // report how many redundant state calls the cache skipped and how
+    // texture streaming is progressing
+    if (now - lastStatsTime >= 1.0f) {
+      const GLStateStats &stats = GLStateCache::Instance().LastFrame();
+      std::cout << "GL state calls per frame: " << stats.issued
+                << " issued, " << stats.elided << " elided\n";
+      TextureStreamStats streaming = textureLoader.TakeStats();
+      if (streaming.decodeQueue + streaming.uploadQueue > 0 ||
+          streaming.bytesUploaded > 0)
+        std::cout << "texture streaming: " << streaming.decodeQueue
+                  << " decoding, " << streaming.uploadQueue
+                  << " uploading, " << streaming.texturesCompleted
+                  << " completed, " << streaming.MegabytesPerSecond()
+                  << " MB/s\n";
+      lastStatsTime = now;
+    }
 
     // keyboard and mouse
-    camera.keyControl(mainWindow.getsKeys(), deltaTime);
-    camera.mouseControl(mainWindow.getXChange(), mainWindow.getYChange());
+    if (!headless) {
+      camera.keyControl(mainWindow.getsKeys(), deltaTime);
+      camera.mouseControl(mainWindow.getXChange(), mainWindow.getYChange());
+    }
 
     // screen skybox color
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -121,6 +208,7 @@ int main() {
     uniformModel = shaderList[0].GetModelLocation();
     uniformProjection = shaderList[0].GetProjectionLocation();
     uniformView = shaderList[0].GetViewLocation();
+    uniformNormalMatrix = shaderList[0].GetNormalMatrixLocation();
     uniformAmbientColor = shaderList[0].GetAmbientColorLocation();
     uniformAmbientIntensity = shaderList[0].GetAmbientIntensityLocation();
     uniformDiffuseIntensity = shaderList[0].GetDiffuseIntensityLocation();
@@ -137,41 +225,56 @@ int main() {
       curAngle -= 360;
     }
 
-    // triangle render
-    // this will initialize model to identity matirx
+    // projection and camera are shared by every draw this frame
+    glm::mat4 view = camera.calculateViewMatrix();
+    glUniformMatrix4fv(uniformProjection, 1, GL_FALSE,
+                       glm::value_ptr(projection));
+    glUniformMatrix4fv(uniformView, 1, GL_FALSE, glm::value_ptr(view));
+
+    // record each object's draw, then submit them sorted by texture and
+    // mesh, front to back within each group
+    drawBucket.Clear();
+    // triangle: this will initialize model to identity matirx
     glm::mat4 model = glm::identity<glm::mat4>();
     // now scale, rotate then translate
     model = glm::translate(model, glm::vec3(-0.8f, 0.0f, -2.5f));
     // model =
     // glm::rotate(model, curAngle * toRadians, glm::vec3(1.0f, 1.0f, 1.0f));
     model = glm::scale(model, glm::vec3(0.4f, 0.4f, 1.0f));
-    // assign those changes to model matrix
-    glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-    // apply projection to it
-    glUniformMatrix4fv(uniformProjection, 1, GL_FALSE,
-                       glm::value_ptr(projection));
-    // and camera
-    glUniformMatrix4fv(uniformView, 1, GL_FALSE,
-                       glm::value_ptr(camera.calculateViewMatrix()));
-    // then apply the texture
-    brickTexture.UseTexture();
-    // now ready for rendering
-    meshList[0]->RenderMesh();
-    // cube render
+    RecordDraw(meshList[0], &brickTexture, model, view);
+    // cube
     model = glm::identity<glm::mat4>();
     model = glm::translate(model, glm::vec3(1.5f, 0.0f, -5.0f));
     model = glm::scale(model, glm::vec3(0.8f, 0.8f, 0.8f));
     // model = glm::rotate(model, 2 * curAngle * toRadians, glm::vec3(1, -1,
     // -1));
-    glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(uniformProjection, 1, GL_FALSE,
-                       glm::value_ptr(projection));
-    dirtTexture.UseTexture();
-    meshList[1]->RenderMesh();
-    // stop the program and redo the while
-    glUseProgram(0);
+    RecordDraw(meshList[1], &dirtTexture, model, view);
+    drawBucket.Sort();
+
+    drawBucket.Submit([&](const MeshDraw &draw) {
+      // assign the model matrix
+      glUniformMatrix4fv(uniformModel, 1, GL_FALSE,
+                         glm::value_ptr(draw.model));
+      // normals need the inverse-transpose once per object, not per vertex
+      glm::mat3 normalMatrix =
+          glm::transpose(glm::inverse(glm::mat3(draw.model)));
+      glUniformMatrix3fv(uniformNormalMatrix, 1, GL_FALSE,
+                         glm::value_ptr(normalMatrix));
+      // then apply the texture and render
+      draw.texture->UseTexture();
+      draw.mesh->RenderMesh();
+    });
+    // the program stays bound; UseShader is elided next frame
     // swap with the buffer window
-    mainWindow.swapBuffers();
+    if (headless)
+      offscreen.EndFrame();
+    else
+      mainWindow.swapBuffers();
   }
+  // the textures are globals, so they let go of the cache before it goes
+  brickTexture.ClearTexture();
+  dirtTexture.ClearTexture();
+  textureCache.Destroy();
+  textureLoader.Destroy();
   return 0;
 }
@@ -0,0 +1,185 @@
+// Cooks images into .ctex files (see CookedTexture.h) with the complete
+// mip chain computed here, so the apps skip decoding and mipmap generation
+// at startup. Levels are block compressed by default, spread over all
+// cores.
+// Build from Triangle/ (no GL needed):
+//   g++ -O2 -std=c++17 -pthread -I. -o texcook tools/texcook.cpp
+//       CookedTexture.cpp BlockCompression.cpp
+// Usage: ./texcook [-f auto|bc1|bc3|rgba8] image.png [image2.png ...]
+//   writes image.ctex next to each image; auto, the default, picks BC1
+//   for opaque images and BC3 for the rest
+#define STB_IMAGE_IMPLEMENTATION
+#include "BlockCompression.h"
+#include "CookedTexture.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// COOKED_RGBA8, COOKED_BC1 or COOKED_BC3; 0 picks per image
+static uint32_t requestedFormat = 0;
+
+struct MipLevel {
+  int width, height;
+  std::vector<unsigned char> pixels;
+};
+
+// 2x2 box filter down to the next level. Odd edges reuse their last row
+// or column. Like glGenerateMipmap on a non-sRGB texture it averages the
+// stored values.
+static MipLevel Downsample(const MipLevel &src) {
+  MipLevel dst;
+  dst.width = src.width > 1 ? src.width / 2 : 1;
+  dst.height = src.height > 1 ? src.height / 2 : 1;
+  dst.pixels.resize((size_t)dst.width * dst.height * 4);
+  for (int y = 0; y < dst.height; ++y) {
+    int y0 = 2 * y < src.height ? 2 * y : src.height - 1;
+    int y1 = 2 * y + 1 < src.height ? 2 * y + 1 : y0;
+    for (int x = 0; x < dst.width; ++x) {
+      int x0 = 2 * x < src.width ? 2 * x : src.width - 1;
+      int x1 = 2 * x + 1 < src.width ? 2 * x + 1 : x0;
+      const unsigned char *p[4] = {
+          &src.pixels[((size_t)y0 * src.width + x0) * 4],
+          &src.pixels[((size_t)y0 * src.width + x1) * 4],
+          &src.pixels[((size_t)y1 * src.width + x0) * 4],
+          &src.pixels[((size_t)y1 * src.width + x1) * 4]};
+      unsigned char *out = &dst.pixels[((size_t)y * dst.width + x) * 4];
+      for (int c = 0; c < 4; ++c)
+        out[c] = (unsigned char)((p[0][c] + p[1][c] + p[2][c] + p[3][c] + 2) /
+                                 4);
+    }
+  }
+  return dst;
+}
+
+// Encodes a level into blocks, splitting its block rows across threads.
+static std::vector<unsigned char> EncodeLevel(const MipLevel &level,
+                                              BlockFormat format) {
+  std::vector<unsigned char> blocks(
+      BlockCompressedSize(level.width, level.height, format));
+  int blockRows = (level.height + 3) / 4;
+  // small levels are not worth a thread
+  int threadCount = (int)std::max(1u, std::thread::hardware_concurrency());
+  threadCount = std::min(threadCount, (blockRows + 15) / 16);
+  std::vector<std::thread> threads;
+  for (int t = 1; t < threadCount; ++t)
+    threads.emplace_back(EncodeBlockRows, level.pixels.data(), level.width,
+                         level.height, format, blockRows * t / threadCount,
+                         blockRows * (t + 1) / threadCount, blocks.data());
+  EncodeBlockRows(level.pixels.data(), level.width, level.height, format, 0,
+                  blockRows / threadCount, blocks.data());
+  for (std::thread &thread : threads)
+    thread.join();
+  return blocks;
+}
+
+static bool IsOpaque(const MipLevel &level) {
+  for (size_t i = 3; i < level.pixels.size(); i += 4)
+    if (level.pixels[i] != 255)
+      return false;
+  return true;
+}
+
+static size_t AlignUp(size_t value) {
+  return (value + COOKED_DATA_ALIGNMENT - 1) & ~(COOKED_DATA_ALIGNMENT - 1);
+}
+
+static bool Cook(const char *inputPath) {
+  MipLevel base;
+  int channels;
+  unsigned char *pixels =
+      stbi_load(inputPath, &base.width, &base.height, &channels, 4);
+  if (!pixels) {
+    std::fprintf(stderr, "%s: %s\n", inputPath, stbi_failure_reason());
+    return false;
+  }
+  base.pixels.assign(pixels, pixels + (size_t)base.width * base.height * 4);
+  stbi_image_free(pixels);
+
+  std::vector<MipLevel> levels;
+  levels.push_back(std::move(base));
+  while (levels.back().width > 1 || levels.back().height > 1)
+    levels.push_back(Downsample(levels.back()));
+
+  uint32_t format = requestedFormat;
+  if (format == 0)
+    format = IsOpaque(levels[0]) ? COOKED_BC1 : COOKED_BC3;
+  if (format != COOKED_RGBA8)
+    for (MipLevel &level : levels)
+      level.pixels = EncodeLevel(
+          level, format == COOKED_BC1 ? BLOCK_BC1 : BLOCK_BC3);
+
+  CookedTextureHeader header = {};
+  std::memcpy(header.magic, COOKED_TEXTURE_MAGIC, 4);
+  header.version = COOKED_TEXTURE_VERSION;
+  header.format = format;
+  header.width = levels[0].width;
+  header.height = levels[0].height;
+  header.levelCount = (uint32_t)levels.size();
+
+  std::vector<CookedLevelEntry> entries(levels.size());
+  size_t offset = AlignUp(sizeof(header) +
+                          entries.size() * sizeof(CookedLevelEntry));
+  for (size_t i = 0; i < levels.size(); ++i) {
+    entries[i].offset = offset;
+    entries[i].size = levels[i].pixels.size();
+    entries[i].width = levels[i].width;
+    entries[i].height = levels[i].height;
+    offset = AlignUp(offset + entries[i].size);
+  }
+
+  std::string outputPath = CookedTexturePath(inputPath);
+  FILE *f = std::fopen(outputPath.c_str(), "wb");
+  if (!f) {
+    std::fprintf(stderr, "%s: cannot write\n", outputPath.c_str());
+    return false;
+  }
+  std::vector<unsigned char> file(offset, 0);
+  std::memcpy(file.data(), &header, sizeof(header));
+  std::memcpy(file.data() + sizeof(header), entries.data(),
+              entries.size() * sizeof(CookedLevelEntry));
+  for (size_t i = 0; i < levels.size(); ++i)
+    std::memcpy(file.data() + entries[i].offset, levels[i].pixels.data(),
+                entries[i].size);
+  bool ok = std::fwrite(file.data(), 1, file.size(), f) == file.size();
+  ok = std::fclose(f) == 0 && ok;
+  if (ok)
+    std::printf("%s -> %s (%s %dx%d, %zu levels, %zu bytes)\n", inputPath,
+                outputPath.c_str(),
+                format == COOKED_BC1   ? "BC1"
+                : format == COOKED_BC3 ? "BC3"
+                                       : "RGBA8",
+                header.width, header.height, levels.size(), file.size());
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  int first = 1;
+  bool usage = false;
+  if (argc > 2 && std::strcmp(argv[1], "-f") == 0) {
+    const char *name = argv[2];
+    if (std::strcmp(name, "bc1") == 0)
+      requestedFormat = COOKED_BC1;
+    else if (std::strcmp(name, "bc3") == 0)
+      requestedFormat = COOKED_BC3;
+    else if (std::strcmp(name, "rgba8") == 0)
+      requestedFormat = COOKED_RGBA8;
+    else
+      usage = std::strcmp(name, "auto") != 0;
+    first = 3;
+  }
+  if (usage || first >= argc) {
+    std::fprintf(stderr,
+                 "usage: %s [-f auto|bc1|bc3|rgba8] image.png "
+                 "[image2.png ...]\n",
+                 argv[0]);
+    return 2;
+  }
+  int failures = 0;
+  for (int i = first; i < argc; ++i)
+    if (!Cook(argv[i]))
+      ++failures;
+  return failures ? 1 : 0;
+}